@@ -1,15 +1,109 @@
 // ring buffer (aka fixed size circular queue)
 
 #include <cassert>
+#include <cstddef>
+#include <cstring>
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <type_traits>
 #include <stdexcept>
 #include <vector>
 
 template <typename T, unsigned N>
 // requires(N > 0)  // c++20 only
 class ring_buffer final {
+    // power-of-two sizes wrap with a mask instead of a division
+    static constexpr bool pow2 = N > 0 && (N & (N - 1)) == 0;
+
+    static constexpr auto wrap(unsigned i) noexcept -> unsigned {
+        if constexpr (pow2) {
+            return i & (N - 1);
+        } else {
+            return i % N;
+        }
+    }
+
+    // memcpy for trivially copyable types
+    static auto copy(const T* src, unsigned n, T* dst) -> void {
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            if (n > 0)
+                std::memcpy(dst, src, n * sizeof(T));
+        } else {
+            std::copy(src, src + n, dst);
+        }
+    }
+
+    template <bool Const>
+    class basic_iterator {
+        using ring = typename std::conditional<Const, const ring_buffer, ring_buffer>::type;
+
+       public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional<Const, const T*, T*>::type;
+        using reference = typename std::conditional<Const, const T&, T&>::type;
+
+        basic_iterator() = default;
+        basic_iterator(ring* r, unsigned i) : ring_{r}, i_{i} {}
+        // iterator -> const_iterator
+        template <bool C = Const, typename = typename std::enable_if<C>::type>
+        basic_iterator(const basic_iterator<false>& other) : ring_{other.ring_}, i_{other.i_} {}
+
+        auto operator*() const -> reference { return (*ring_)[i_]; }
+        auto operator->() const -> pointer { return &(*ring_)[i_]; }
+        auto operator[](difference_type n) const -> reference { return (*ring_)[i_ + n]; }
+
+        auto operator++() -> basic_iterator& { ++i_; return *this; }
+        auto operator--() -> basic_iterator& { --i_; return *this; }
+        auto operator++(int) -> basic_iterator { auto it = *this; ++i_; return it; }
+        auto operator--(int) -> basic_iterator { auto it = *this; --i_; return it; }
+        auto operator+=(difference_type n) -> basic_iterator& { i_ += n; return *this; }
+        auto operator-=(difference_type n) -> basic_iterator& { i_ -= n; return *this; }
+        auto operator+(difference_type n) const -> basic_iterator { return {ring_, unsigned(i_ + n)}; }
+        auto operator-(difference_type n) const -> basic_iterator { return {ring_, unsigned(i_ - n)}; }
+        friend auto operator+(difference_type n, const basic_iterator& it) -> basic_iterator { return it + n; }
+        auto operator-(const basic_iterator& other) const -> difference_type {
+            return difference_type(i_) - difference_type(other.i_);
+        }
+
+        auto operator==(const basic_iterator& other) const -> bool { return i_ == other.i_; }
+        auto operator!=(const basic_iterator& other) const -> bool { return i_ != other.i_; }
+        auto operator<(const basic_iterator& other) const -> bool { return i_ < other.i_; }
+        auto operator>(const basic_iterator& other) const -> bool { return i_ > other.i_; }
+        auto operator<=(const basic_iterator& other) const -> bool { return i_ <= other.i_; }
+        auto operator>=(const basic_iterator& other) const -> bool { return i_ >= other.i_; }
+
+       private:
+        friend class basic_iterator<true>;
+        ring* ring_ = nullptr;
+        unsigned i_ = 0;  // logical index, 0 is the front
+    };
+
    public:
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    // contiguous piece of the ring
+    template <typename U>
+    struct span {
+        U* data;
+        unsigned size;
+        auto begin() const noexcept -> U* { return data; }
+        auto end() const noexcept -> U* { return data + size; }
+    };
+
+    // the contents in order: first, then second (empty unless wrapped)
+    template <typename U>
+    struct spans {
+        span<U> first;
+        span<U> second;
+    };
+
     ring_buffer() : begin_{0}, size_{0} {}
 
     auto constexpr max_size() const noexcept -> unsigned { return N; }
@@ -19,12 +113,32 @@ class ring_buffer final {
     auto size() const noexcept -> unsigned { return size_; }
 
     auto push(const T& value) -> void {
-        unsigned i = (begin_ + size_) % N;
+        unsigned i = wrap(begin_ + size_);
         buf_[i] = value;
         if (size_ < N) {
             size_++;
         } else {
-            begin_ = (begin_ + 1) % N;
+            begin_ = wrap(begin_ + 1);
+        }
+    }
+
+    // like n calls to push(): when full the oldest values are overwritten
+    auto push_range(const T* values, unsigned n) -> void {
+        if (n >= N) {
+            copy(values + (n - N), N, buf_);
+            begin_ = 0;
+            size_ = N;
+            return;
+        }
+        unsigned tail = wrap(begin_ + size_);
+        unsigned first = std::min(n, N - tail);
+        copy(values, first, buf_ + tail);
+        copy(values + first, n - first, buf_);
+        if (size_ + n > N) {
+            begin_ = wrap(begin_ + size_ + n - N);
+            size_ = N;
+        } else {
+            size_ += n;
         }
     }
 
@@ -32,11 +146,22 @@ class ring_buffer final {
         if (empty())
             throw std::exception();
         T value = buf_[begin_];
-        begin_ = (begin_ + 1) % N;
+        begin_ = wrap(begin_ + 1);
         size_--;
         return value;
     }
 
+    // pops up to n values into out, returns how many
+    auto pop_range(T* out, unsigned n) -> unsigned {
+        n = std::min(n, size_);
+        unsigned first = std::min(n, N - begin_);
+        copy(buf_ + begin_, first, out);
+        copy(buf_, n - first, out + first);
+        begin_ = wrap(begin_ + n);
+        size_ -= n;
+        return n;
+    }
+
     auto front() const -> const T& {
         if (empty())
             throw std::exception();
@@ -46,31 +171,52 @@ class ring_buffer final {
     auto back() const -> const T& {
         if (empty())
             throw std::exception();
-        unsigned i = (begin_ + size_ - 1) % N;
+        unsigned i = wrap(begin_ + size_ - 1);
         return buf_[i];
     }
 
+    auto as_spans() noexcept -> spans<T> { return make_spans<T>(buf_); }
+
+    auto as_spans() const noexcept -> spans<const T> { return make_spans<const T>(buf_); }
+
     auto to_vector() const -> std::vector<T> {
         std::vector<T> vec;
         vec.reserve(size_);
-        for (unsigned i = 0; i < size_; i++) {
-            vec.push_back(buf_[(begin_ + i) % N]);
-        }
+        auto s = as_spans();
+        vec.insert(vec.end(), s.first.begin(), s.first.end());
+        vec.insert(vec.end(), s.second.begin(), s.second.end());
         return vec;
     }
 
+    auto begin() noexcept -> iterator { return {this, 0}; }
+    auto end() noexcept -> iterator { return {this, size_}; }
+    auto begin() const noexcept -> const_iterator { return {this, 0}; }
+    auto end() const noexcept -> const_iterator { return {this, size_}; }
+    auto cbegin() const noexcept -> const_iterator { return begin(); }
+    auto cend() const noexcept -> const_iterator { return end(); }
+
     auto operator[](unsigned i) noexcept -> T& {
         // out-of-range is UB
-        return buf_[(begin_ + i) % N];
+        return buf_[wrap(begin_ + i)];
+    }
+
+    auto operator[](unsigned i) const noexcept -> const T& {
+        return buf_[wrap(begin_ + i)];
     }
 
     auto at(unsigned i) -> T& {
         if (i >= size_)
             throw std::out_of_range("index out-of-range");
-        return buf_[(begin_ + i) % N];
+        return buf_[wrap(begin_ + i)];
     }
 
    private:
+    template <typename U, typename Buf>
+    auto make_spans(Buf& buf) const noexcept -> spans<U> {
+        unsigned first = std::min(size_, N - begin_);
+        return {{buf + begin_, first}, {buf, size_ - first}};
+    }
+
     unsigned begin_ = 0;
     unsigned size_ = 0;
     T buf_[N];
@@ -163,5 +309,55 @@ int main() {
         assert(buf.to_vector() == expected_char_vec);
     }
 
+    {
+        // power of two, wrapped
+        ring_buffer<int, 8> buf;
+        for (int i = 0; i < 11; i++)
+            buf.push(i);  // 8, 9, 10][3, 4, 5, 6, 7,
+        auto s = buf.as_spans();
+        assert(s.first.size == 5 && s.first.data[0] == 3);
+        assert(s.second.size == 3 && s.second.data[0] == 8);
+        assert(std::accumulate(buf.begin(), buf.end(), 0) == 3 + 4 + 5 + 6 + 7 + 8 + 9 + 10);
+        assert(buf.end() - buf.begin() == 8);
+        assert(buf.begin()[5] == 8);
+        assert(*(buf.end() - 1) == 10);
+        std::sort(buf.begin(), buf.end(), std::greater<int>());
+        assert(buf.front() == 10 && buf.back() == 3);
+        const auto& cbuf = buf;
+        ring_buffer<int, 8>::const_iterator it = buf.begin();
+        assert(it == cbuf.begin() && it < cbuf.end());
+
+        int out[8];
+        assert(buf.pop_range(out, 3) == 3);
+        assert(out[0] == 10 && out[2] == 8);
+        assert(buf.size() == 5);
+
+        const int more[] = {20, 21, 22, 23, 24, 25};
+        buf.push_range(more, 6);  // 3 oldest are overwritten
+        std::vector<int> expected = {4, 3, 20, 21, 22, 23, 24, 25};
+        assert(buf.to_vector() == expected);
+        assert(buf.pop_range(out, 100) == 8);
+        assert(buf.empty() && out[7] == 25);
+
+        const int many[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+        buf.push_range(many, 10);  // only the last 8 fit
+        assert(buf.front() == 3 && buf.back() == 10 && buf.size() == 8);
+    }
+
+    {
+        // not a power of two, non trivial type
+        ring_buffer<std::string, 3> buf;
+        const std::string words[] = {"a", "b", "c", "d"};
+        buf.push_range(words, 2);
+        buf.push_range(words + 2, 2);  // [d][b, c
+        std::vector<std::string> expected = {"b", "c", "d"};
+        assert(buf.to_vector() == expected);
+        assert(std::vector<std::string>(buf.begin(), buf.end()) == expected);
+        std::string out[3];
+        assert(buf.pop_range(out, 3) == 3);
+        assert(out[0] == "b" && out[2] == "d");
+        assert(buf.as_spans().first.size == 0);
+    }
+
     std::cout << "OK" << std::endl;
 }
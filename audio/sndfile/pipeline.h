@@ -0,0 +1,119 @@
+// TODO copyright
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace snd {
+
+// bounded single-producer/single-consumer queue, capacity rounded up to a
+// power of two; Push/Pop wait (spin, yield, then sleep) when full/empty
+template <typename T>
+class SpscQueue {
+public:
+	explicit SpscQueue(size_t capacity)
+		: slots_(RoundUp(capacity)), mask_(slots_.size() - 1), head_(0), tail_(0) {
+	}
+
+	bool TryPush(const T& value) {
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+			return false;
+		}
+		slots_[tail & mask_] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(T& value) {
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if (tail_.load(std::memory_order_acquire) == head) {
+			return false;
+		}
+		value = slots_[head & mask_];
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	void Push(const T& value) {
+		for (unsigned spins = 0; !TryPush(value); ++spins) {
+			Backoff(spins);
+		}
+	}
+
+	T Pop() {
+		T value;
+		for (unsigned spins = 0; !TryPop(value); ++spins) {
+			Backoff(spins);
+		}
+		return value;
+	}
+
+private:
+	static size_t RoundUp(size_t n) {
+		size_t pow2 = 1;
+		while (pow2 < n) pow2 <<= 1;
+		return pow2;
+	}
+
+	// a stage waits on disk I/O for milliseconds, so don't burn the core
+	// another file's pipeline could use
+	static void Backoff(unsigned spins) {
+		if (spins < 64) {
+			return;
+		} else if (spins < 128) {
+			std::this_thread::yield();
+		} else {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+	std::vector<T> slots_;
+	const size_t mask_;
+	alignas(64) std::atomic<size_t> head_;
+	alignas(64) std::atomic<size_t> tail_;
+};
+
+// one pipeline buffer of samples as read
+struct Block {
+	std::vector<float> samples;
+	size_t count; // samples (items) in use, 0 marks the end of the stream
+};
+
+// fixed set of blocks allocated up front; the first stage takes them, the
+// last one gives them back, so a transcode allocates nothing per block and
+// its memory is bounded by the pool
+class BlockPool {
+public:
+	BlockPool(size_t blocks, size_t samples)
+		: blocks_(blocks), free_(blocks) {
+		for (Block& block : blocks_) {
+			block.samples.resize(samples);
+			block.count = 0;
+			free_.Push(&block);
+		}
+	}
+
+	Block* Take() {
+		return free_.Pop();
+	}
+
+	void Give(Block* block) {
+		free_.Push(block);
+	}
+
+	size_t samples() const {
+		return blocks_.empty() ? 0 : blocks_[0].samples.size();
+	}
+
+private:
+	std::vector<Block> blocks_;
+	SpscQueue<Block*> free_;
+};
+
+}
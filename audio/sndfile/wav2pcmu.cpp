@@ -1,35 +1,182 @@
 // TODO copyright
 
-#include <cassert>
+// Transcodes WAV to G.711 u-law WAV in two stages on their own threads:
+//   read (libsndfile, float) -> encode and write (libsndfile, u-law)
+// connected by bounded SPSC queues of blocks from a fixed pool, so reading
+// the next block overlaps encoding and writing this one. The encoding stays
+// in libsndfile (sf_write_float), which defines the output bytes, including
+// for out of range and non-finite samples.
+// --batch transcodes many files at once over a pool of workers, one
+// pipeline per file in flight.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pipeline.h"
 #include "snd.h"
 
-int main(int argc, char** argv) {
-	if (argc != 3) {
-		std::cout << "Wrong number of parameters: " << argc << std::endl;
-		std::cout << "Usage:" << std::endl;
-		std::cout << "wav2pcmu input.wav output.wav" << std::endl;
-		return 1;
-	}
+namespace {
 
-	snd::InFile in(argv[1]);
-	assert(in.Good());
+const size_t kFramesPerBlock = 4096;
+const size_t kBlocks = 8; // in flight per pipeline
 
+struct Result {
+	bool ok;
+	sf_count_t frames;
+	double seconds;
+};
+
+Result Transcode(const std::string& input, const std::string& output) {
+	const auto start = std::chrono::steady_clock::now();
+	Result result = { false, 0, 0.0 };
+
+	snd::InFile in(input);
+	if (!in.Good()) return result;
 	SF_INFO info = in.info();
 	info.format = SF_FORMAT_WAV | SF_FORMAT_ULAW;
-	snd::OutFile out(argv[2], info);
-	assert(out.Good());
-
-	const size_t size = 4096;
-	float buffer[size];
-	int read = 0;
-	while ((read = in.Read(buffer, size)) > 0) {
-		int written = out.Write(buffer, read);
-		if (written != read) {
-			std::cout << "write errror. " << read << "!=" << written << std::endl;
+	snd::OutFile out(output, info);
+	if (!out.Good()) return result;
+
+	// whole frames per block, sf_read_float counts items of all channels
+	const size_t samples = kFramesPerBlock * info.channels;
+	snd::BlockPool pool(kBlocks, samples);
+	snd::SpscQueue<snd::Block*> read(kBlocks);
+
+	std::thread reader([&] {
+		for (;;) {
+			snd::Block* block = pool.Take();
+			const int n = in.Read(block->samples.data(), samples);
+			block->count = n > 0 ? n : 0;
+			read.Push(block);
+			if (block->count == 0) break;
+		}
+	});
+
+	// encode and write on the calling thread; after an error keep draining,
+	// so the reader doesn't block forever
+	bool write_error = false;
+	for (;;) {
+		snd::Block* block = read.Pop();
+		const size_t count = block->count;
+		if (count > 0 && !write_error) {
+			const int written = out.Write(block->samples.data(), count);
+			if (written != static_cast<int>(count)) {
+				std::cout << "write error. " << count << "!=" << written << std::endl;
+				write_error = true;
+			}
 		}
+		result.frames += count / info.channels;
+		pool.Give(block);
+		if (count == 0) break;
 	}
+	reader.join();
 
-	return 0;
+	result.ok = !write_error && result.frames == info.frames;
+	if (!result.ok) {
+		// don't leave a truncated file that looks like a good one
+		out.Close();
+		std::remove(output.c_str());
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
 }
 
+std::string BaseName(const std::string& path) {
+	const size_t slash = path.rfind('/');
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// every input into out_dir under its own name, `jobs` files at a time;
+// refuses to start when two inputs would write the same output
+int Batch(const std::string& out_dir, const std::vector<std::string>& inputs, unsigned jobs) {
+	std::vector<std::string> outputs;
+	std::map<std::string, size_t> seen;
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		outputs.push_back(out_dir + "/" + BaseName(inputs[i]));
+		const auto inserted = seen.emplace(outputs[i], i);
+		if (!inserted.second) {
+			std::cout << inputs[inserted.first->second] << " and " << inputs[i] << " both write "
+			          << outputs[i] << std::endl;
+			return 1;
+		}
+	}
+
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> failed(0);
+	std::mutex print_mutex;
+	sf_count_t frames = 0;
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (unsigned j = 0; j < jobs; ++j) {
+		workers.emplace_back([&] {
+			for (size_t i = next++; i < inputs.size(); i = next++) {
+				const Result r = Transcode(inputs[i], outputs[i]);
+				std::lock_guard<std::mutex> lock(print_mutex);
+				if (r.ok) {
+					frames += r.frames;
+					std::cout << inputs[i] << ": " << r.frames << " frames, " << r.seconds << " s" << std::endl;
+				} else {
+					++failed;
+					std::cout << inputs[i] << ": failed" << std::endl;
+				}
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << inputs.size() - failed << "/" << inputs.size() << " files, " << frames << " frames, "
+	          << seconds << " s, " << jobs << " jobs" << std::endl;
+	return failed == 0 ? 0 : 1;
+}
+
+void Usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "wav2pcmu input.wav output.wav" << std::endl;
+	std::cout << "wav2pcmu --batch [-j jobs] output_dir input.wav..." << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+	if (argc >= 2 && std::strcmp(argv[1], "--batch") == 0) {
+		int arg = 2;
+		unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+		if (arg + 1 < argc && std::strcmp(argv[arg], "-j") == 0) {
+			jobs = std::max(1, std::atoi(argv[arg + 1]));
+			arg += 2;
+		}
+		if (argc - arg < 2) {
+			Usage();
+			return 1;
+		}
+		const std::string out_dir = argv[arg];
+		const std::vector<std::string> inputs(argv + arg + 1, argv + argc);
+		return Batch(out_dir, inputs, std::min<unsigned>(jobs, inputs.size()));
+	}
+
+	if (argc != 3) {
+		std::cout << "Wrong number of parameters: " << argc << std::endl;
+		Usage();
+		return 1;
+	}
+
+	const Result r = Transcode(argv[1], argv[2]);
+	if (!r.ok) {
+		std::cout << "transcode failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -1,16 +1,30 @@
 // CRC-32 Castagnoli Reversed (0x82F63B78)
 // compare results to http://www.digsys.se/JavaScript/CRC.aspx or
 // http://checksumcalc.live.conceptcontrols.com/
-// compile: gcc -msse4.2 -Wall -Wextra crc32.c
+// compile: gcc -O2 -pthread -Wall -Wextra crc32.c
 // usage: crc32 <input> <output>
+//        crc32 --parallel <input>
+//        crc32 --mode <buffered|mmap|direct|all> <input>
+//        crc32 --bench
+
+#define _GNU_SOURCE  // O_DIRECT
 
 #include <nmmintrin.h>
+#include <wmmintrin.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #define CRC32_INITIAL 0xFFFFFFFFu
 #define CRC32_XOR_OUT 0xFFFFFFFFu
@@ -109,11 +123,511 @@ uint32_t crc32c_sw_u32(uint32_t crc, const uint32_t input) {
   return crc;
 }
 
+// Bulk API: crc32c(data, size, seed)
+// seed is a previous crc32c() result (0 to start), so calls can be chained.
+// Hardware path runs _mm_crc32_u64 over three interleaved streams (the crc32
+// instruction has 3 cycles latency and 1 cycle throughput) and merges the
+// partial CRCs with a carry-less multiply. Without SSE4.2/PCLMUL it falls back
+// to slice-by-16 (slice-by-8 also handles the head/tail bytes).
+// Little-endian only.
+
+#define CRC32C_LONG 8192u
+#define CRC32C_SHORT 256u
+
+static uint32_t crc_slice_table[16][256];
+static uint32_t crc_shift_long[2];   // x^(8*LONG-33), x^(16*LONG-33)
+static uint32_t crc_shift_short[2];  // x^(8*SHORT-33), x^(16*SHORT-33)
+
+typedef uint32_t (*crc32c_fn)(uint32_t, const uint8_t*, size_t);
+static crc32c_fn crc32c_impl = NULL;
+static bool crc32c_hw_supported = false;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+// only the hardware kernels are built for SSE4.2/PCLMUL, the rest of the
+// file runs anywhere and crc32c_init() picks them at run time
+#define CRC32C_HW __attribute__((target("sse4.2,pclmul")))
+
+// a * b mod P, bit-reflected (bit 31 is x^0)
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b) {
+  uint32_t m = 1u << 31;
+  uint32_t p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) break;
+    }
+    m >>= 1;
+    b = b & 1 ? (b >> 1) ^ CRC32_POLYNOMIAL : b >> 1;
+  }
+  return p;
+}
+
+// x^n mod P
+static uint32_t crc32c_xpow(uint64_t n) {
+  uint32_t p = 1u << 31;  // x^0
+  uint32_t sq = 1u << 30; // x^1
+  while (n) {
+    if (n & 1) p = crc32c_multmodp(sq, p);
+    sq = crc32c_multmodp(sq, sq);
+    n >>= 1;
+  }
+  return p;
+}
+
+static uint32_t crc32c_sw_slice8(uint32_t crc, const uint8_t* p, size_t n) {
+  while (n && ((uintptr_t)p & 7)) {
+    crc = crc32c_sw_u8(crc, *p++);
+    n--;
+  }
+  while (n >= 8) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    w ^= crc;
+    crc = crc_slice_table[7][w & 0xFF] ^ crc_slice_table[6][(w >> 8) & 0xFF] ^
+          crc_slice_table[5][(w >> 16) & 0xFF] ^ crc_slice_table[4][(w >> 24) & 0xFF] ^
+          crc_slice_table[3][(w >> 32) & 0xFF] ^ crc_slice_table[2][(w >> 40) & 0xFF] ^
+          crc_slice_table[1][(w >> 48) & 0xFF] ^ crc_slice_table[0][w >> 56];
+    p += 8;
+    n -= 8;
+  }
+  while (n--) crc = crc32c_sw_u8(crc, *p++);
+  return crc;
+}
+
+static uint32_t crc32c_sw_slice16(uint32_t crc, const uint8_t* p, size_t n) {
+  while (n && ((uintptr_t)p & 7)) {
+    crc = crc32c_sw_u8(crc, *p++);
+    n--;
+  }
+  while (n >= 16) {
+    uint64_t w0, w1;
+    memcpy(&w0, p, 8);
+    memcpy(&w1, p + 8, 8);
+    w0 ^= crc;
+    crc = crc_slice_table[15][w0 & 0xFF] ^ crc_slice_table[14][(w0 >> 8) & 0xFF] ^
+          crc_slice_table[13][(w0 >> 16) & 0xFF] ^ crc_slice_table[12][(w0 >> 24) & 0xFF] ^
+          crc_slice_table[11][(w0 >> 32) & 0xFF] ^ crc_slice_table[10][(w0 >> 40) & 0xFF] ^
+          crc_slice_table[9][(w0 >> 48) & 0xFF] ^ crc_slice_table[8][w0 >> 56] ^
+          crc_slice_table[7][w1 & 0xFF] ^ crc_slice_table[6][(w1 >> 8) & 0xFF] ^
+          crc_slice_table[5][(w1 >> 16) & 0xFF] ^ crc_slice_table[4][(w1 >> 24) & 0xFF] ^
+          crc_slice_table[3][(w1 >> 32) & 0xFF] ^ crc_slice_table[2][(w1 >> 40) & 0xFF] ^
+          crc_slice_table[1][(w1 >> 48) & 0xFF] ^ crc_slice_table[0][w1 >> 56];
+    p += 16;
+    n -= 16;
+  }
+  return crc32c_sw_slice8(crc, p, n);
+}
+
+CRC32C_HW static uint32_t crc32c_hw_u8(uint32_t crc, const uint8_t input) {
+  return _mm_crc32_u8(crc, input);
+}
+
+CRC32C_HW static uint32_t crc32c_hw_u32(uint32_t crc, const uint32_t input) {
+  return _mm_crc32_u32(crc, input);
+}
+
+// single stream, for comparison
+CRC32C_HW static uint32_t crc32c_hw_u64(uint32_t crc, const uint8_t* p, size_t n) {
+  uint64_t crc64 = crc;
+  while (n && ((uintptr_t)p & 7)) {
+    crc64 = _mm_crc32_u8((uint32_t)crc64, *p++);
+    n--;
+  }
+  while (n >= 8) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    crc64 = _mm_crc32_u64(crc64, w);
+    p += 8;
+    n -= 8;
+  }
+  while (n--) crc64 = _mm_crc32_u8((uint32_t)crc64, *p++);
+  return (uint32_t)crc64;
+}
+
+// crc * x^(8 * n) mod P, where k = x^(8 * n - 33) mod P
+// clmul of two reflected 32-bit values gives a 63-bit product that is off by
+// one x; _mm_crc32_u64 reduces it and multiplies by x^32.
+CRC32C_HW static inline uint32_t crc32c_shift_hw(uint32_t k, uint32_t crc) {
+  __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc), _mm_cvtsi32_si128(k), 0x00);
+  return (uint32_t)_mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(prod));
+}
+
+CRC32C_HW static inline const uint8_t* crc32c_hw_3way(uint64_t* crc, const uint8_t* p, size_t block,
+                                                      const uint32_t shift[2]) {
+  uint64_t crc0 = *crc;
+  uint64_t crc1 = 0;
+  uint64_t crc2 = 0;
+  const uint8_t* end = p + block;
+  do {
+    uint64_t w0, w1, w2;
+    memcpy(&w0, p, 8);
+    memcpy(&w1, p + block, 8);
+    memcpy(&w2, p + 2 * block, 8);
+    crc0 = _mm_crc32_u64(crc0, w0);
+    crc1 = _mm_crc32_u64(crc1, w1);
+    crc2 = _mm_crc32_u64(crc2, w2);
+    p += 8;
+  } while (p < end);
+  *crc = crc32c_shift_hw(shift[1], (uint32_t)crc0) ^ crc32c_shift_hw(shift[0], (uint32_t)crc1) ^
+         crc2;
+  return p + 2 * block;
+}
+
+CRC32C_HW static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t n) {
+  uint64_t crc64 = crc;
+  while (n && ((uintptr_t)p & 7)) {
+    crc64 = _mm_crc32_u8((uint32_t)crc64, *p++);
+    n--;
+  }
+  while (n >= 3 * CRC32C_LONG) {
+    p = crc32c_hw_3way(&crc64, p, CRC32C_LONG, crc_shift_long);
+    n -= 3 * CRC32C_LONG;
+  }
+  while (n >= 3 * CRC32C_SHORT) {
+    p = crc32c_hw_3way(&crc64, p, CRC32C_SHORT, crc_shift_short);
+    n -= 3 * CRC32C_SHORT;
+  }
+  return crc32c_hw_u64((uint32_t)crc64, p, n);
+}
+
+static void crc32c_init_once(void) {
+  for (int i = 0; i < 256; ++i) {
+    crc_slice_table[0][i] = crc_table[i];
+  }
+  for (int k = 1; k < 16; ++k) {
+    for (int i = 0; i < 256; ++i) {
+      uint32_t prev = crc_slice_table[k - 1][i];
+      crc_slice_table[k][i] = (prev >> 8) ^ crc_table[prev & 0xFF];
+    }
+  }
+  crc_shift_long[0] = crc32c_xpow(8 * CRC32C_LONG - 33);
+  crc_shift_long[1] = crc32c_xpow(16 * CRC32C_LONG - 33);
+  crc_shift_short[0] = crc32c_xpow(8 * CRC32C_SHORT - 33);
+  crc_shift_short[1] = crc32c_xpow(16 * CRC32C_SHORT - 33);
+
+  __builtin_cpu_init();
+  crc32c_hw_supported = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul");
+  crc32c_impl = crc32c_hw_supported ? crc32c_hw : crc32c_sw_slice16;
+}
+
+// safe to call from any thread, the tables are built once
+void crc32c_init(void) {
+  pthread_once(&crc32c_once, crc32c_init_once);
+}
+
+uint32_t crc32c(const void* data, size_t size, uint32_t seed) {
+  crc32c_init();
+  return crc32c_impl(seed ^ CRC32_XOR_OUT, (const uint8_t*)data, size) ^ CRC32_XOR_OUT;
+}
+
+static uint32_t crc32c_table_u8(uint32_t crc, const uint8_t* p, size_t n) {
+  while (n--) crc = crc32c_sw_u8(crc, *p++);
+  return crc;
+}
+
+static uint32_t crc32c_table_u32(uint32_t crc, const uint8_t* p, size_t n) {
+  for (; n >= 4; n -= 4, p += 4) {
+    uint32_t w;
+    memcpy(&w, p, 4);
+    crc = crc32c_sw_u32(crc, w);
+  }
+  return crc32c_table_u8(crc, p, n);
+}
+
+// Combine: crc32c(A + B) from crc32c(A), crc32c(B) and len(B).
+// Appending len(B) zero bytes to A is a linear operator on the CRC register,
+// so it is applied as a 32x32 GF(2) matrix raised to the power 8 * len(B) by
+// repeated squaring (same approach as zlib's crc32_combine).
+
+static uint32_t gf2_matrix_times(const uint32_t* mat, uint32_t vec) {
+  uint32_t sum = 0;
+  while (vec) {
+    if (vec & 1) sum ^= *mat;
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+static void gf2_matrix_square(uint32_t* square, const uint32_t* mat) {
+  for (int n = 0; n < 32; n++) {
+    square[n] = gf2_matrix_times(mat, mat[n]);
+  }
+}
+
+uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b) {
+  uint32_t even[32];  // even-power-of-two zeros operator
+  uint32_t odd[32];   // odd-power-of-two zeros operator
+
+  if (len_b == 0) return crc_a;
+
+  // operator for one zero bit
+  odd[0] = CRC32_POLYNOMIAL;
+  uint32_t row = 1;
+  for (int n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+  gf2_matrix_square(even, odd);  // two zero bits
+  gf2_matrix_square(odd, even);  // four zero bits
+
+  // first square puts the operator for one zero byte (eight zero bits) in even
+  do {
+    gf2_matrix_square(even, odd);
+    if (len_b & 1) crc_a = gf2_matrix_times(even, crc_a);
+    len_b >>= 1;
+    if (len_b == 0) break;
+
+    gf2_matrix_square(odd, even);
+    if (len_b & 1) crc_a = gf2_matrix_times(odd, crc_a);
+    len_b >>= 1;
+  } while (len_b != 0);
+
+  return crc_a ^ crc_b;
+}
+
+// Parallel driver: one chunk per thread, merged with crc32c_combine().
+
+#define CRC32C_MIN_CHUNK (1u << 20)
+
+struct crc32c_chunk {
+  pthread_t thread;
+  bool started;  // false: the caller runs the chunk itself
+  const uint8_t* data;
+  size_t size;
+  uint32_t crc;
+};
+
+static void* crc32c_chunk_run(void* arg) {
+  struct crc32c_chunk* chunk = arg;
+  chunk->crc = crc32c(chunk->data, chunk->size, 0);
+  return NULL;
+}
+
+// threads <= 0 uses one thread per online core
+uint32_t crc32c_parallel(const void* data, size_t size, uint32_t seed, int threads) {
+  if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if ((size_t)threads > size / CRC32C_MIN_CHUNK) threads = (int)(size / CRC32C_MIN_CHUNK);
+  if (threads <= 1) return crc32c(data, size, seed);
+
+  struct crc32c_chunk* chunks = calloc(threads, sizeof(*chunks));
+  if (!chunks) return crc32c(data, size, seed);
+  const uint8_t* p = data;
+  size_t chunk_size = size / threads;
+  for (int i = 0; i < threads; i++) {
+    chunks[i].data = p + i * chunk_size;
+    chunks[i].size = i == threads - 1 ? size - i * chunk_size : chunk_size;
+    if (i > 0) {
+      chunks[i].started = pthread_create(&chunks[i].thread, NULL, crc32c_chunk_run, &chunks[i]) == 0;
+    }
+  }
+  crc32c_chunk_run(&chunks[0]);  // the caller takes the first chunk
+  uint32_t crc = crc32c_combine(seed, chunks[0].crc, chunks[0].size);
+  for (int i = 1; i < threads; i++) {
+    if (chunks[i].started) {
+      pthread_join(chunks[i].thread, NULL);
+    } else {
+      crc32c_chunk_run(&chunks[i]);  // no thread for it, do it serially
+    }
+    crc = crc32c_combine(crc, chunks[i].crc, chunks[i].size);
+  }
+  free(chunks);
+  return crc;
+}
+
+// File input modes. Each returns 0 and the checksum in *crc, -1 on error.
+
+#define CRC32C_IO_BLOCK (4u << 20)
+#define CRC32C_DIRECT_ALIGN 4096u
+
+// read(2) through the page cache into one reused buffer
+int crc32c_file_buffered(const char* path, uint32_t* crc) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  uint8_t* buffer = malloc(CRC32C_IO_BLOCK);
+  assert(buffer);
+  uint32_t sum = 0;
+  ssize_t n;
+  while ((n = read(fd, buffer, CRC32C_IO_BLOCK)) > 0) {
+    sum = crc32c(buffer, (size_t)n, sum);
+  }
+  free(buffer);
+  close(fd);
+  if (n < 0) return -1;
+  *crc = sum;
+  return 0;
+}
+
+// O_DIRECT bypasses the page cache: buffer, size and offsets must be aligned
+// to the logical block size. A short read is not necessarily the end, only a
+// read returning 0 is; after an unaligned short read in the middle of the
+// file the next read fails. Fails on file systems without O_DIRECT support
+// (e.g. tmpfs).
+int crc32c_file_direct(const char* path, uint32_t* crc) {
+  int fd = open(path, O_RDONLY | O_DIRECT);
+  if (fd < 0) return -1;
+  void* buffer;
+  if (posix_memalign(&buffer, CRC32C_DIRECT_ALIGN, CRC32C_IO_BLOCK) != 0) {
+    close(fd);
+    return -1;
+  }
+  uint32_t sum = 0;
+  ssize_t n;
+  while ((n = read(fd, buffer, CRC32C_IO_BLOCK)) > 0) {
+    sum = crc32c(buffer, (size_t)n, sum);
+  }
+  free(buffer);
+  close(fd);
+  if (n < 0) return -1;
+  *crc = sum;
+  return 0;
+}
+
+// mmap the whole file with MADV_SEQUENTIAL and checksum it with
+// crc32c_parallel() (threads <= 0: one per core, 1: serial)
+int crc32c_file_mmap(const char* path, int threads, uint32_t* crc) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return -1;
+  }
+  size_t size = (size_t)st.st_size;
+  if (size == 0) {
+    close(fd);
+    *crc = 0;
+    return 0;
+  }
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return -1;
+  madvise(data, size, MADV_SEQUENTIAL);
+  *crc = crc32c_parallel(data, size, 0, threads);
+  munmap(data, size);
+  return 0;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench(void) {
+  const size_t size = 64u << 20;
+  uint8_t* buffer = malloc(size);
+  assert(buffer);
+  for (size_t i = 0; i < size; i++) buffer[i] = (uint8_t)(i * 2654435761u >> 24);
+
+  crc32c_init();
+  struct {
+    const char* name;
+    crc32c_fn fn;
+    bool supported;
+  } paths[] = {
+    { "table u8 (crc32c_sw_u8)", crc32c_table_u8, true },
+    { "table u32 (crc32c_sw_u32)", crc32c_table_u32, true },
+    { "slice-by-8", crc32c_sw_slice8, true },
+    { "slice-by-16", crc32c_sw_slice16, true },
+    { "hw u64, 1 stream", crc32c_hw_u64, crc32c_hw_supported },
+    { "hw u64, 3 streams + pclmul", crc32c_hw, crc32c_hw_supported },
+  };
+  uint32_t expected = crc32c_sw_slice8(CRC32_INITIAL, buffer, size);
+  for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+    if (!paths[i].supported) continue;
+    int rounds = i < 2 ? 1 : 8;
+    uint32_t crc = 0;
+    double start = now_sec();
+    for (int r = 0; r < rounds; r++) {
+      crc = paths[i].fn(CRC32_INITIAL, buffer, size);
+    }
+    double elapsed = now_sec() - start;
+    // checked without assert, so release builds report a wrong kernel too
+    printf("%-28s %8.2f GB/s%s\n", paths[i].name, (double)size * rounds / elapsed / 1e9,
+           crc == expected ? "" : " MISMATCH");
+  }
+
+  int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  for (int threads = 1; threads <= cores; threads *= 2) {
+    const int rounds = 8;
+    uint32_t crc = 0;
+    double start = now_sec();
+    for (int r = 0; r < rounds; r++) {
+      crc = crc32c_parallel(buffer, size, 0, threads);
+    }
+    double elapsed = now_sec() - start;
+    printf("parallel, %2d threads %14.2f GB/s%s\n", threads, (double)size * rounds / elapsed / 1e9,
+           crc == (expected ^ CRC32_XOR_OUT) ? "" : " MISMATCH");
+  }
+  free(buffer);
+}
+
+static int crc32c_file_mmap_serial(const char* path, uint32_t* crc) {
+  return crc32c_file_mmap(path, 1, crc);
+}
+
+// asks the kernel to evict the file's (clean) pages, so a mode does not
+// read what the previous one left in the page cache; pages mapped or
+// locked elsewhere stay, so it is best effort
+static void crc32c_drop_cache(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// checksum the file with one or all input modes and report throughput,
+// every mode starts with the file dropped from the page cache
+static int io_modes(const char* mode, const char* path) {
+  struct {
+    const char* name;
+    int (*fn)(const char*, uint32_t*);
+  } modes[] = {
+    { "buffered", crc32c_file_buffered },
+    { "mmap", crc32c_file_mmap_serial },
+    { "direct", crc32c_file_direct },
+  };
+  struct stat st;
+  if (stat(path, &st) < 0) {
+    printf("Error: stat input file '%s'.\n", path);
+    return 1;
+  }
+  int found = 0;
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    if (strcmp(mode, "all") != 0 && strcmp(mode, modes[i].name) != 0) continue;
+    found = 1;
+    uint32_t crc;
+    crc32c_drop_cache(path);
+    double start = now_sec();
+    int rc = modes[i].fn(path, &crc);
+    double elapsed = now_sec() - start;
+    if (rc != 0) {
+      printf("%-8s   error\n", modes[i].name);
+      failed = 1;
+      continue;
+    }
+    printf("%-8s 0x%08X %8.2f GB/s (%.3f s)\n", modes[i].name, crc,
+           (double)st.st_size / elapsed / 1e9, elapsed);
+  }
+  if (!found) {
+    printf("Error: unknown mode '%s'.\n", mode);
+    return 1;
+  }
+  return failed;
+}
+
 int main(int argc, char** argv) {
   if (argc == 1) {
     // make_table();
     // print_table();
 
+    // the hardware checks fall back to the table on CPUs without SSE4.2
+    crc32c_init();
+    const bool hw = crc32c_hw_supported;
+
     const char input[] = "abcdefgh";
     uint32_t crc_sw = CRC32_INITIAL;
     uint32_t crc_sw_slow = CRC32_INITIAL;
@@ -121,7 +635,7 @@ int main(int argc, char** argv) {
     for (uint32_t i = 0u; i < strlen(input); i++) {
       crc_sw = crc32c_sw_u8(crc_sw, input[i]);
       crc_sw_slow = crc32c_sw_u8_slow(crc_sw_slow, input[i]);
-      crc_hw = _mm_crc32_u8(crc_hw, input[i]);
+      crc_hw = hw ? crc32c_hw_u8(crc_hw, input[i]) : crc32c_sw_u8(crc_hw, input[i]);
       //printf("# sw=0x%08x, hw=0x%08x\n", crc_sw, crc_hw);
       assert(crc_sw == crc_hw);
       assert(crc_sw_slow == crc_hw);
@@ -138,7 +652,7 @@ int main(int argc, char** argv) {
     crc_hw = CRC32_INITIAL;
     for (uint32_t i = 0u; i < 2u; i++) {
       crc_sw = crc32c_sw_u32(crc_sw, input_u32[i]);
-      crc_hw = _mm_crc32_u32(crc_hw, input_u32[i]);
+      crc_hw = hw ? crc32c_hw_u32(crc_hw, input_u32[i]) : crc32c_sw_u32(crc_hw, input_u32[i]);
       printf("* sw=0x%08x, hw=0x%08x\n", crc_sw, crc_hw);
       assert(crc_sw == crc_hw);
     }
@@ -154,13 +668,61 @@ int main(int argc, char** argv) {
 
     crc_hw = CRC32_INITIAL;
     for (uint32_t i = 0u; i < 8; i++) {
-      crc_hw = _mm_crc32_u8(crc_hw, input3[i]);
+      crc_hw = hw ? crc32c_hw_u8(crc_hw, input3[i]) : crc32c_sw_u8(crc_hw, input3[i]);
     }
     crc_hw ^= CRC32_XOR_OUT;
     printf(">>>> hw=0x%08x\n", crc_hw);
 
+    assert(0x0A9421B7 == crc32c(input, strlen(input), 0));
+    assert(0x0A9421B7 == crc32c(input + 3, 5, crc32c(input, 3, 0)));
+
+    // every path must agree, on all lengths and alignments around the block sizes
+    static uint8_t big[3 * CRC32C_LONG * 2 + 100];
+    for (size_t i = 0; i < sizeof(big); i++) big[i] = (uint8_t)(i * 31u + 7u);
+    const size_t sizes[] = { 0, 1, 7, 8, 9, 3 * CRC32C_SHORT - 1, 3 * CRC32C_SHORT,
+                             3 * CRC32C_SHORT + 13, 3 * CRC32C_LONG, sizeof(big) - 3 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      for (size_t offset = 0; offset < 3; offset++) {
+        const uint8_t* p = big + offset;
+        uint32_t ref = crc32c_table_u8(CRC32_INITIAL, p, sizes[s]);
+        assert(ref == crc32c_table_u32(CRC32_INITIAL, p, sizes[s]));
+        assert(ref == crc32c_sw_slice8(CRC32_INITIAL, p, sizes[s]));
+        assert(ref == crc32c_sw_slice16(CRC32_INITIAL, p, sizes[s]));
+        assert(!hw || ref == crc32c_hw_u64(CRC32_INITIAL, p, sizes[s]));
+        assert(!hw || ref == crc32c_hw(CRC32_INITIAL, p, sizes[s]));
+        (void)ref;
+      }
+    }
+
+    for (size_t split = 0; split <= 8; split++) {
+      assert(0x0A9421B7 ==
+             crc32c_combine(crc32c(input, split, 0), crc32c(input + split, 8 - split, 0), 8 - split));
+    }
+    static uint8_t huge[5 * CRC32C_MIN_CHUNK + 3];
+    memset(huge, 0x5A, sizeof(huge));
+    uint32_t huge_crc = crc32c(huge, sizeof(huge), 0);
+    for (int threads = 1; threads <= 7; threads++) {
+      assert(huge_crc == crc32c_parallel(huge, sizeof(huge), 0, threads));
+    }
+    assert(crc32c(huge, sizeof(huge), 0x1234u) == crc32c_parallel(huge, sizeof(huge), 0x1234u, 4));
+    (void)huge_crc;
+
     puts("ok");
 
+  } else if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+
+  } else if (argc == 3 && strcmp(argv[1], "--parallel") == 0) {
+    uint32_t crc;
+    if (crc32c_file_mmap(argv[2], 0, &crc) != 0) {
+      printf("Error: read input file '%s'.", argv[2]);
+      return 1;
+    }
+    printf("0x%08X\n", crc);
+
+  } else if (argc == 4 && strcmp(argv[1], "--mode") == 0) {
+    return io_modes(argv[2], argv[3]);
+
   } else if (argc == 2) {
     FILE* fp_in = fopen(argv[1], "rb");
     if (!fp_in) {
@@ -168,18 +730,19 @@ int main(int argc, char** argv) {
       return 1;
     }
     rewind(fp_in);
-    int c;
-    uint32_t crc = CRC32_INITIAL;
-    while ((c = fgetc(fp_in)) != EOF) {
-      crc = crc32c_sw_u8(crc, c);
+    uint8_t buffer[64 * 1024];
+    size_t n;
+    uint32_t crc = 0;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp_in)) > 0) {
+      crc = crc32c(buffer, n, crc);
     }
-    crc ^= CRC32_XOR_OUT;
     fclose(fp_in);
 
     printf("0x%08X\n", crc);
     
   } else {
-    puts("usage: exe <input file>\n");
+    puts("usage: exe [<input file> | --parallel <input file> |\n"
+         "           --mode <buffered|mmap|direct|all> <input file> | --bench]\n");
     return 1;
   }
 
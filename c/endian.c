@@ -1,33 +1,52 @@
+// Byte order helpers: per-value Read/Write (traced) and array versions.
+// The array routines byte-swap whole buffers with SSSE3 pshufb or AVX2
+// vpshufb, picked on the first call together with the host byte order;
+// a Read/Write in the host's own order is a plain copy.
+// compile: gcc -O2 -pthread -Wall -Wextra endian.c
+// usage: endian [--bench]
+
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ENDIAN_X86 1
+#endif
+
+// per-value functions print what they do, the benchmark turns that off
+static bool trace = true;
 
 void WriteUint16LE(uint16_t in, uint8_t* out) {
   assert(out != NULL);
   out[0] = in & 0x00FFu;
   out[1] = (in & 0xFF00u) >> 8;
-  printf("W 16 LE: 0x%04x -> \"0x%02x%02x\"\n", in, out[0], out[1]);
+  if (trace) printf("W 16 LE: 0x%04x -> \"0x%02x%02x\"\n", in, out[0], out[1]);
 }
 
 void WriteUint16BE(uint16_t in, uint8_t* out) {
   assert(out != NULL);
   out[0] = (in & 0xFF00u) >> 8;
   out[1] = in & 0x00FFu;
-  printf("W 16 BE: 0x%04x -> \"0x%02x%02x\"\n", in, out[0], out[1]);
+  if (trace) printf("W 16 BE: 0x%04x -> \"0x%02x%02x\"\n", in, out[0], out[1]);
 }
 
 uint16_t ReadUint16LE(const uint8_t* data) {
   assert(data != NULL);
   uint16_t le = data[0] << 0 | data[1] << 8;
-  printf("R 16 LE: \"0x%02x%02x\" -> 0x%04x\n", data[0], data[1], le);
+  if (trace) printf("R 16 LE: \"0x%02x%02x\" -> 0x%04x\n", data[0], data[1], le);
   return le;
 }
 
 uint16_t ReadUint16BE(const uint8_t* data) {
   assert(data != NULL);
   uint16_t be = data[0] << 8 | data[1] << 0;
-  printf("R 16 BE: \"0x%02x%02x\" -> 0x%04x\n", data[0], data[1], be);
+  if (trace) printf("R 16 BE: \"0x%02x%02x\" -> 0x%04x\n", data[0], data[1], be);
   return be;
 }
 
@@ -37,8 +56,8 @@ void WriteUint32LE(uint32_t in, uint8_t* out) {
   out[1] = (in >> 8) & 0xff;
   out[2] = (in >> 16) & 0xff;
   out[3] = in >> 24;
-  printf("W 32 LE: 0x%08x -> \"0x%02x%02x%02x%02x\"\n", in, out[0], out[1], out[2],
-         out[3]);
+  if (trace) printf("W 32 LE: 0x%08x -> \"0x%02x%02x%02x%02x\"\n", in, out[0], out[1], out[2],
+                    out[3]);
 }
 
 void WriteUint32BE(uint32_t in, uint8_t* out) {
@@ -47,27 +66,395 @@ void WriteUint32BE(uint32_t in, uint8_t* out) {
   out[1] = (in >> 16) & 0xff;
   out[2] = (in >> 8) & 0xff;
   out[3] = in & 0xFF;
-  printf("W 32 BE: 0x%08x -> \"0x%02x%02x%02x%02x\"\n", in, out[0], out[1], out[2],
-         out[3]);
+  if (trace) printf("W 32 BE: 0x%08x -> \"0x%02x%02x%02x%02x\"\n", in, out[0], out[1], out[2],
+                    out[3]);
 }
 
 uint32_t ReadUint32LE(const uint8_t* data) {
   assert(data != NULL);
   uint32_t le = data[0] << 0 | data[1] << 8 | data[2] << 16 | data[3] << 24;
-  printf("R 32 LE: \"0x%02x%02x%02x%02x\" -> 0x%08x\n", data[0], data[1], data[2],
-         data[3], le);
+  if (trace) printf("R 32 LE: \"0x%02x%02x%02x%02x\" -> 0x%08x\n", data[0], data[1], data[2],
+                    data[3], le);
   return le;
 }
 
 uint32_t ReadUint32BE(const uint8_t* data) {
   assert(data != NULL);
   uint32_t be = data[3] << 0 | data[2] << 8 | data[1] << 16 | data[0] << 24;
-  printf("R32  BE: \"0x%02x%02x%02x%02x\" -> 0x%08x\n", data[0], data[1], data[2],
-         data[3], be);
+  if (trace) printf("R32  BE: \"0x%02x%02x%02x%02x\" -> 0x%08x\n", data[0], data[1], data[2],
+                    data[3], be);
   return be;
 }
 
-int main(void) {
+// Array versions. dst and src may be the same buffer (in-place swap), but
+// must not overlap otherwise. count is in elements.
+
+typedef void (*swap_fn)(uint8_t* dst, const uint8_t* src, size_t count, unsigned width);
+
+static swap_fn swap_impl;
+static bool host_little_endian;
+static pthread_once_t endian_once = PTHREAD_ONCE_INIT;
+
+static void SwapScalar(uint8_t* dst, const uint8_t* src, size_t count, unsigned width) {
+  // one loop per width, memcpy keeps unaligned access defined
+  if (width == 2) {
+    for (size_t i = 0; i < count; ++i) {
+      uint16_t v;
+      memcpy(&v, src + 2 * i, 2);
+      v = __builtin_bswap16(v);
+      memcpy(dst + 2 * i, &v, 2);
+    }
+  } else if (width == 4) {
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t v;
+      memcpy(&v, src + 4 * i, 4);
+      v = __builtin_bswap32(v);
+      memcpy(dst + 4 * i, &v, 4);
+    }
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t v;
+      memcpy(&v, src + 8 * i, 8);
+      v = __builtin_bswap64(v);
+      memcpy(dst + 8 * i, &v, 8);
+    }
+  }
+}
+
+#ifdef ENDIAN_X86
+
+// pshufb control reversing each 2, 4 or 8 byte group of a 16 byte lane
+static const uint8_t swap_mask[3][16] = {
+  { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+  { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+  { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 },
+};
+
+static const uint8_t* SwapMask(unsigned width) {
+  return swap_mask[width == 2 ? 0 : width == 4 ? 1 : 2];
+}
+
+__attribute__((target("ssse3")))
+static void SwapSsse3(uint8_t* dst, const uint8_t* src, size_t count, unsigned width) {
+  const __m128i mask = _mm_loadu_si128((const __m128i*)SwapMask(width));
+  size_t bytes = count * width;
+  size_t i = 0;
+  for (; i + 64 <= bytes; i += 64) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 32));
+    __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 48));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(a, mask));
+    _mm_storeu_si128((__m128i*)(dst + i + 16), _mm_shuffle_epi8(b, mask));
+    _mm_storeu_si128((__m128i*)(dst + i + 32), _mm_shuffle_epi8(c, mask));
+    _mm_storeu_si128((__m128i*)(dst + i + 48), _mm_shuffle_epi8(d, mask));
+  }
+  for (; i + 16 <= bytes; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(a, mask));
+  }
+  SwapScalar(dst + i, src + i, (bytes - i) / width, width);
+}
+
+// vpshufb shuffles within each 128 bit lane, so the same mask serves both.
+// 32 byte accesses that split a cache line run at about half the rate of
+// the SSSE3 kernel, so this one only takes buffers that can both be brought
+// to a 32 byte boundary (same offset, reachable in whole elements).
+__attribute__((target("avx2")))
+static void SwapAvx2(uint8_t* dst, const uint8_t* src, size_t count, unsigned width) {
+  const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)SwapMask(width)));
+  size_t bytes = count * width;
+  size_t i = (32 - ((uintptr_t)dst & 31)) & 31;
+  if ((((uintptr_t)dst ^ (uintptr_t)src) & 31) != 0 || i % width != 0 || i > bytes) {
+    SwapSsse3(dst, src, count, width);
+    return;
+  }
+  SwapScalar(dst, src, i / width, width);
+  for (; i + 128 <= bytes; i += 128) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+    __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 64));
+    __m256i d = _mm256_loadu_si256((const __m256i*)(src + i + 96));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(a, mask));
+    _mm256_storeu_si256((__m256i*)(dst + i + 32), _mm256_shuffle_epi8(b, mask));
+    _mm256_storeu_si256((__m256i*)(dst + i + 64), _mm256_shuffle_epi8(c, mask));
+    _mm256_storeu_si256((__m256i*)(dst + i + 96), _mm256_shuffle_epi8(d, mask));
+  }
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(a, mask));
+  }
+  SwapSsse3(dst + i, src + i, (bytes - i) / width, width);
+}
+
+#endif
+
+static void EndianInitOnce(void) {
+  const uint16_t one = 1;
+  host_little_endian = *(const uint8_t*)&one == 1;
+  swap_impl = SwapScalar;
+#ifdef ENDIAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    swap_impl = SwapAvx2;
+  } else if (__builtin_cpu_supports("ssse3")) {
+    swap_impl = SwapSsse3;
+  }
+#endif
+}
+
+// safe from any thread, the first call picks the kernel
+static void EndianInit(void) {
+  pthread_once(&endian_once, EndianInitOnce);
+}
+
+static void Swap(void* dst, const void* src, size_t count, unsigned width) {
+  EndianInit();
+  swap_impl(dst, src, count, width);
+}
+
+// byte order `little` to host order or back: the same swap, or a copy
+static void Convert(void* dst, const void* src, size_t count, unsigned width, bool little) {
+  EndianInit();
+  if (little != host_little_endian) {
+    swap_impl(dst, src, count, width);
+  } else if (dst != src && count > 0) {
+    memcpy(dst, src, count * width);
+  }
+}
+
+void Bswap16Array(uint16_t* dst, const uint16_t* src, size_t count) { Swap(dst, src, count, 2); }
+void Bswap32Array(uint32_t* dst, const uint32_t* src, size_t count) { Swap(dst, src, count, 4); }
+void Bswap64Array(uint64_t* dst, const uint64_t* src, size_t count) { Swap(dst, src, count, 8); }
+
+void ReadUint16ArrayLE(const uint8_t* data, uint16_t* out, size_t count) { Convert(out, data, count, 2, true); }
+void ReadUint16ArrayBE(const uint8_t* data, uint16_t* out, size_t count) { Convert(out, data, count, 2, false); }
+void ReadUint32ArrayLE(const uint8_t* data, uint32_t* out, size_t count) { Convert(out, data, count, 4, true); }
+void ReadUint32ArrayBE(const uint8_t* data, uint32_t* out, size_t count) { Convert(out, data, count, 4, false); }
+void ReadUint64ArrayLE(const uint8_t* data, uint64_t* out, size_t count) { Convert(out, data, count, 8, true); }
+void ReadUint64ArrayBE(const uint8_t* data, uint64_t* out, size_t count) { Convert(out, data, count, 8, false); }
+
+void WriteUint16ArrayLE(const uint16_t* in, size_t count, uint8_t* out) { Convert(out, in, count, 2, true); }
+void WriteUint16ArrayBE(const uint16_t* in, size_t count, uint8_t* out) { Convert(out, in, count, 2, false); }
+void WriteUint32ArrayLE(const uint32_t* in, size_t count, uint8_t* out) { Convert(out, in, count, 4, true); }
+void WriteUint32ArrayBE(const uint32_t* in, size_t count, uint8_t* out) { Convert(out, in, count, 4, false); }
+void WriteUint64ArrayLE(const uint64_t* in, size_t count, uint8_t* out) { Convert(out, in, count, 8, true); }
+void WriteUint64ArrayBE(const uint64_t* in, size_t count, uint8_t* out) { Convert(out, in, count, 8, false); }
+
+static void TestArrays(void) {
+  struct {
+    const char* name;
+    swap_fn fn;
+    bool supported;
+  } kernels[] = {
+    { "scalar", SwapScalar, true },
+#ifdef ENDIAN_X86
+    { "ssse3", SwapSsse3, __builtin_cpu_supports("ssse3") },
+    { "avx2", SwapAvx2, __builtin_cpu_supports("avx2") },
+#endif
+  };
+  uint8_t src[8 * 300 + 1];
+  uint8_t expected[sizeof(src)];
+  _Alignas(32) uint8_t in[sizeof(src) + 32];
+  _Alignas(32) uint8_t got[sizeof(src) + 32];
+  for (size_t i = 0; i < sizeof(src); ++i) src[i] = (uint8_t)(i * 2654435761u >> 24);
+
+  for (unsigned width = 2; width <= 8; width *= 2) {
+    // odd offset: unaligned loads and stores; all counts up to 300 cover
+    // every vector loop plus tail combination
+    for (size_t count = 0; count <= 300; ++count) {
+      for (size_t i = 0; i < count * width; ++i) {
+        expected[i] = src[1 + i / width * width + (width - 1 - i % width)];
+      }
+      for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (!kernels[k].supported) continue;
+        memset(got, 0, sizeof(got));
+        kernels[k].fn(got, src + 1, count, width);
+        assert(memcmp(got, expected, count * width) == 0);
+        assert(got[count * width] == 0);
+        memcpy(got, src + 1, count * width);
+        kernels[k].fn(got, got, count, width);
+        assert(memcmp(got, expected, count * width) == 0);
+        // src and dst at the same offset from a 32 byte boundary
+        for (size_t offset = 0; offset < 32; offset += width) {
+          memcpy(in + offset, src + 1, count * width);
+          kernels[k].fn(got + offset, in + offset, count, width);
+          assert(memcmp(got + offset, expected, count * width) == 0);
+        }
+      }
+    }
+  }
+  (void)expected;  // only read by the asserts
+
+  // agree with the per-value functions
+  trace = false;
+  uint16_t v16[3];
+  uint32_t v32[3];
+  uint64_t v64[3];
+  uint8_t out[24];
+  ReadUint16ArrayLE(src, v16, 3);
+  ReadUint32ArrayBE(src, v32, 3);
+  for (int i = 0; i < 3; ++i) {
+    assert(v16[i] == ReadUint16LE(src + 2 * i));
+    assert(v32[i] == ReadUint32BE(src + 4 * i));
+  }
+  ReadUint16ArrayBE(src, v16, 3);
+  ReadUint32ArrayLE(src, v32, 3);
+  for (int i = 0; i < 3; ++i) {
+    assert(v16[i] == ReadUint16BE(src + 2 * i));
+    assert(v32[i] == ReadUint32LE(src + 4 * i));
+  }
+  ReadUint64ArrayBE(src, v64, 3);
+  assert(v64[0] == ((uint64_t)ReadUint32BE(src) << 32 | ReadUint32BE(src + 4)));
+  WriteUint64ArrayBE(v64, 3, out);
+  assert(memcmp(out, src, 24) == 0);
+  ReadUint64ArrayLE(src, v64, 3);
+  assert(v64[0] == ((uint64_t)ReadUint32LE(src + 4) << 32 | ReadUint32LE(src)));
+  WriteUint64ArrayLE(v64, 3, out);
+  assert(memcmp(out, src, 24) == 0);
+  WriteUint32ArrayBE(v32, 3, out);
+  for (int i = 0; i < 3; ++i) {
+    uint8_t one[4];
+    WriteUint32BE(v32[i], one);
+    assert(memcmp(out + 4 * i, one, 4) == 0);
+  }
+  WriteUint16ArrayLE(v16, 3, out);
+  for (int i = 0; i < 3; ++i) {
+    uint8_t one[2];
+    WriteUint16LE(v16[i], one);
+    assert(memcmp(out + 2 * i, one, 2) == 0);
+  }
+  Bswap32Array(v32, v32, 3);
+  Bswap16Array(v16, v16, 3);
+  for (int i = 0; i < 3; ++i) {
+    assert(v32[i] == ReadUint32BE(src + 4 * i));
+    assert(v16[i] == ReadUint16LE(src + 2 * i));
+  }
+  trace = true;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// per-value loops over the traced functions, as callers write them today
+static void PerValueRead16BE(const uint8_t* data, uint16_t* out, size_t count) {
+  for (size_t i = 0; i < count; ++i) out[i] = ReadUint16BE(data + 2 * i);
+}
+
+static void PerValueRead32BE(const uint8_t* data, uint32_t* out, size_t count) {
+  for (size_t i = 0; i < count; ++i) out[i] = ReadUint32BE(data + 4 * i);
+}
+
+static void PerValueWrite32BE(const uint32_t* in, size_t count, uint8_t* out) {
+  for (size_t i = 0; i < count; ++i) WriteUint32BE(in[i], out + 4 * i);
+}
+
+static void PerValueRead32LE(const uint8_t* data, uint32_t* out, size_t count) {
+  for (size_t i = 0; i < count; ++i) out[i] = ReadUint32LE(data + 4 * i);
+}
+
+// GB/s of fn over `bytes`, best of a few rounds; the buffer stays in L2 for
+// the small size and streams from memory for the large one
+static double Measure(void (*fn)(void*, const void*, size_t), void* dst, const void* src,
+                      size_t bytes) {
+  double best = 0;
+  for (int round = 0; round < 5; ++round) {
+    int reps = (int)(((size_t)256 << 20) / bytes);
+    double start = now_sec();
+    for (int r = 0; r < reps; ++r) {
+      fn(dst, src, bytes);
+      __asm__ volatile("" : : "r"(dst) : "memory");
+    }
+    double rate = (double)bytes * reps / (now_sec() - start) / 1e9;
+    if (rate > best) best = rate;
+  }
+  return best;
+}
+
+#define BENCH_WRAP(name, call) \
+  static void name(void* dst, const void* src, size_t bytes) { call; }
+
+BENCH_WRAP(BenchPerValue16, PerValueRead16BE(src, dst, bytes / 2))
+BENCH_WRAP(BenchPerValue32, PerValueRead32BE(src, dst, bytes / 4))
+BENCH_WRAP(BenchPerValueW32, PerValueWrite32BE(src, bytes / 4, dst))
+BENCH_WRAP(BenchPerValueLE32, PerValueRead32LE(src, dst, bytes / 4))
+BENCH_WRAP(BenchScalar16, SwapScalar(dst, src, bytes / 2, 2))
+BENCH_WRAP(BenchScalar32, SwapScalar(dst, src, bytes / 4, 4))
+BENCH_WRAP(BenchScalar64, SwapScalar(dst, src, bytes / 8, 8))
+#ifdef ENDIAN_X86
+BENCH_WRAP(BenchSsse3_16, SwapSsse3(dst, src, bytes / 2, 2))
+BENCH_WRAP(BenchSsse3_32, SwapSsse3(dst, src, bytes / 4, 4))
+BENCH_WRAP(BenchSsse3_64, SwapSsse3(dst, src, bytes / 8, 8))
+BENCH_WRAP(BenchAvx2_16, SwapAvx2(dst, src, bytes / 2, 2))
+BENCH_WRAP(BenchAvx2_32, SwapAvx2(dst, src, bytes / 4, 4))
+BENCH_WRAP(BenchAvx2_64, SwapAvx2(dst, src, bytes / 8, 8))
+#endif
+BENCH_WRAP(BenchRead16BE, ReadUint16ArrayBE(src, dst, bytes / 2))
+BENCH_WRAP(BenchRead32BE, ReadUint32ArrayBE(src, dst, bytes / 4))
+BENCH_WRAP(BenchWrite32BE, WriteUint32ArrayBE(src, bytes / 4, dst))
+BENCH_WRAP(BenchRead32LE, ReadUint32ArrayLE(src, dst, bytes / 4))
+BENCH_WRAP(BenchRead64BE, ReadUint64ArrayBE(src, dst, bytes / 8))
+
+static void Bench(void) {
+  struct {
+    const char* name;
+    void (*fn)(void*, const void*, size_t);
+    bool supported;
+  } runs[] = {
+    { "ReadUint16BE per value", BenchPerValue16, true },
+    { "bswap16 scalar", BenchScalar16, true },
+#ifdef ENDIAN_X86
+    { "bswap16 ssse3", BenchSsse3_16, __builtin_cpu_supports("ssse3") },
+    { "bswap16 avx2", BenchAvx2_16, __builtin_cpu_supports("avx2") },
+#endif
+    { "ReadUint16ArrayBE", BenchRead16BE, true },
+    { "ReadUint32BE per value", BenchPerValue32, true },
+    { "WriteUint32BE per value", BenchPerValueW32, true },
+    { "bswap32 scalar", BenchScalar32, true },
+#ifdef ENDIAN_X86
+    { "bswap32 ssse3", BenchSsse3_32, __builtin_cpu_supports("ssse3") },
+    { "bswap32 avx2", BenchAvx2_32, __builtin_cpu_supports("avx2") },
+#endif
+    { "ReadUint32ArrayBE", BenchRead32BE, true },
+    { "WriteUint32ArrayBE", BenchWrite32BE, true },
+    { "bswap64 scalar", BenchScalar64, true },
+#ifdef ENDIAN_X86
+    { "bswap64 ssse3", BenchSsse3_64, __builtin_cpu_supports("ssse3") },
+    { "bswap64 avx2", BenchAvx2_64, __builtin_cpu_supports("avx2") },
+#endif
+    { "ReadUint64ArrayBE", BenchRead64BE, true },
+    { "ReadUint32LE per value", BenchPerValueLE32, true },
+    { "ReadUint32ArrayLE", BenchRead32LE, true },
+  };
+  const size_t sizes[] = { 64u << 10, 64u << 20 };
+  uint8_t* src = aligned_alloc(64, sizes[1]);
+  uint8_t* dst = aligned_alloc(64, sizes[1]);
+  assert(src && dst);
+  for (size_t i = 0; i < sizes[1]; ++i) src[i] = (uint8_t)(i * 2654435761u >> 24);
+  memset(dst, 0, sizes[1]);
+
+  EndianInit();
+  trace = false;
+  printf("host is %s endian\n", host_little_endian ? "little" : "big");
+  printf("%-26s %12s %12s\n", "", "64 KiB GB/s", "64 MiB GB/s");
+  for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); ++i) {
+    if (!runs[i].supported) continue;
+    printf("%-26s %12.2f %12.2f\n", runs[i].name, Measure(runs[i].fn, dst, src, sizes[0]),
+           Measure(runs[i].fn, dst, src, sizes[1]));
+  }
+  trace = true;
+  free(src);
+  free(dst);
+}
+
+int main(int argc, char** argv) {
+  if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+    Bench();
+    return 0;
+  }
 
   // data 43981 LE encoded
   const uint8_t data16_le[] = { 0xcd, 0xab };
@@ -108,6 +495,7 @@ int main(void) {
   uint32_t be32 = ReadUint32BE(data32_be);
   assert(1234567890u == be32);
   assert(0x499602d2u == be32);
+  (void)be32;
 
   // Write LE
   uint8_t out32_le[4] = {0};
@@ -125,6 +513,8 @@ int main(void) {
   //  assert(1234567890u == *((uint32_t*)data32_be));
   //#endif
 
+  TestArrays();
+
   puts("ok");
 
   return 0;
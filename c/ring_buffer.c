@@ -42,6 +42,8 @@ uint32_t Count(const RingBuffer* rb) {
   return rb->length;
 }
 
+// define RING_BUFFER_TRACE to print every Push/Pop
+#ifdef RING_BUFFER_TRACE
 static void PrintPush(const uint8_t data[], uint32_t length) {
   printf("push([ ");
   for (uint32_t i = 0; i < length; i++) {
@@ -57,6 +59,7 @@ static void PrintPop(const uint8_t data[], uint32_t length) {
   }
   printf("]\n");
 }
+#endif
 
 void Print(const RingBuffer* rb) {
   printf("[ ");
@@ -86,8 +89,10 @@ _Bool Push(RingBuffer* rb, const uint8_t data[], uint32_t data_length) {
   } else {
     rb->length += data_length;
   }
+#ifdef RING_BUFFER_TRACE
   PrintPush(data, data_length);
   Print(rb);
+#endif
   return TRUE;
 }
 
@@ -103,8 +108,10 @@ _Bool Pop(RingBuffer* rb, uint8_t data[], uint32_t data_length) {
   memcpy(&data[len], rb->buf, data_length - len);
   rb->begin = (rb->begin + data_length) % rb->capacity;
   rb->length -= data_length;
+#ifdef RING_BUFFER_TRACE
   PrintPop(data, data_length);
   Print(rb);
+#endif
   return TRUE;
 }
 
@@ -118,6 +125,8 @@ _Bool Equal(const uint8_t actual[], const uint8_t expected[], uint32_t length) {
   return TRUE;
 }
 
+// define RING_BUFFER_NO_MAIN to include this file in a benchmark
+#ifndef RING_BUFFER_NO_MAIN
 int main() {
   // empty buffer
   printf("\n:test 0:\n");
@@ -356,3 +365,4 @@ int main() {
   puts("\nok");
   return 0;
 }
+#endif
@@ -78,10 +78,12 @@ _Bool Push(RingBuffer* rb, const uint16_t data[], uint32_t data_length) {
   } else {
     rb->length += data_length;
   }
+#ifdef RING_BUFFER_TRACE
   printf("push(");
   PrintArrayU16(data, data_length);
   printf(")\n");
   PrintRB(rb);
+#endif
   return TRUE;
 }
 
@@ -97,10 +99,12 @@ _Bool Pop(RingBuffer* rb, uint16_t data[], uint32_t data_length) {
   }
   rb->begin = (rb->begin + data_length) % rb->capacity;
   rb->length -= data_length;
+#ifdef RING_BUFFER_TRACE
   printf("pop(%u) -> ", data_length);
   PrintArrayU16(data, data_length);
   printf("\n");
   PrintRB(rb);
+#endif
   return TRUE;
 }
 
@@ -114,6 +118,8 @@ _Bool Equal(const uint16_t actual[], const uint16_t expected[], uint32_t length)
   return TRUE;
 }
 
+// define RING_BUFFER_NO_MAIN to include this file in a benchmark
+#ifndef RING_BUFFER_NO_MAIN
 int main() {
   /*
   [ ] : {0, 0}
@@ -345,3 +351,4 @@ int main() {
   puts("ok");
   return 0;
 }
+#endif
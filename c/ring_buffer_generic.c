@@ -0,0 +1,165 @@
+// Tests for ring_buffer_generic.h and a benchmark against ring_buffer.c (u8)
+// and ring_buffer2.c (u16)
+// compile: gcc -O2 -Wall -Wextra ring_buffer_generic.c
+
+#include <stdio.h>
+#include <time.h>
+
+#include "ring_buffer_generic.h"
+
+RING_BUFFER_DEFINE(RingU8, uint8_t)
+RING_BUFFER_DEFINE(RingU16, uint16_t)
+
+typedef struct {
+  uint32_t id;
+  double value;
+} Sample;
+
+RING_BUFFER_DEFINE(RingSample, Sample)
+
+// both C variants use the same names, rename them on the way in
+#define RING_BUFFER_NO_MAIN
+#define RingBuffer RingBufferU8
+#define Init InitU8
+#define Release ReleaseU8
+#define Empty EmptyU8
+#define Count CountU8
+#define Print PrintU8
+#define Push PushU8
+#define Pop PopU8
+#define Equal EqualU8
+#include "ring_buffer.c"
+#undef RingBuffer
+#undef Init
+#undef Release
+#undef Empty
+#undef Count
+#undef Print
+#undef Push
+#undef Pop
+#undef Equal
+
+#define RingBuffer RingBufferU16
+#define Init InitU16
+#define Release ReleaseU16
+#define Empty EmptyU16
+#define Count CountU16
+#define Push PushU16
+#define Pop PopU16
+#define Equal EqualU16
+#include "ring_buffer2.c"
+#undef RingBuffer
+#undef Init
+#undef Release
+#undef Empty
+#undef Count
+#undef Push
+#undef Pop
+#undef Equal
+
+static void Test(void) {
+  // same scenarios as ring_buffer.c, with power-of-two capacities
+  RingU8 rb1;
+  RingU8Init(&rb1, 5);
+  assert(rb1.capacity == 8);
+  assert(RingU8Empty(&rb1));
+  const uint8_t input1[3] = {1, 2, 3};
+  assert(RingU8Push(&rb1, input1, 3));
+  assert(RingU8Count(&rb1) == 3);
+  uint8_t pop1[3] = {0};
+  assert(RingU8Pop(&rb1, pop1, 3));
+  assert(RingU8Empty(&rb1));
+  assert(memcmp(pop1, input1, 3) == 0);
+  assert(!RingU8Pop(&rb1, pop1, 1));
+  RingU8Release(&rb1);
+  assert(rb1.buf == NULL);
+
+  // wraparound and overwrite of the oldest elements
+  RingU16 rb2;
+  RingU16Init(&rb2, 4);
+  rb2.begin = 3;
+  const uint16_t input2[3] = {1000, 2000, 3000};
+  assert(RingU16Push(&rb2, input2, 3));
+  const uint16_t expected2[2] = {2000, 3000};
+  assert(memcmp(rb2.buf, expected2, sizeof(expected2)) == 0);
+  assert(rb2.buf[3] == 1000);
+  const uint16_t input3[2] = {4000, 5000};
+  assert(RingU16Push(&rb2, input3, 2));
+  assert(RingU16Count(&rb2) == 4);
+  assert(rb2.begin == 0);
+  uint16_t pop2[4];
+  assert(RingU16Pop(&rb2, pop2, 4));
+  const uint16_t expected3[4] = {2000, 3000, 4000, 5000};
+  assert(memcmp(pop2, expected3, sizeof(pop2)) == 0);
+  const uint16_t too_big[5] = {0};
+  assert(!RingU16Push(&rb2, too_big, 5));
+  RingU16Release(&rb2);
+
+  // any copyable type
+  RingSample rb3;
+  RingSampleInit(&rb3, 2);
+  const Sample samples[3] = {{1, 0.5}, {2, 1.5}, {3, 2.5}};
+  assert(RingSamplePush(&rb3, samples, 2));
+  assert(RingSamplePush(&rb3, &samples[2], 1));
+  Sample out[2];
+  assert(RingSamplePop(&rb3, out, 2));
+  assert(out[0].id == 2 && out[1].id == 3 && out[1].value == 2.5);
+  RingSampleRelease(&rb3);
+}
+
+static double Now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define BENCH_BYTES (64u << 20)
+
+// push/pop blocks of 3/8 of the ring so the copies wrap around
+#define BENCH(rb, T, InitFn, PushFn, PopFn, ReleaseFn, size)       \
+  do {                                                             \
+    const uint32_t capacity = (size) / sizeof(T);                  \
+    uint32_t block = capacity * 3 / 8;                             \
+    if (block == 0) block = 1;                                     \
+    T* data = malloc(block * sizeof(T));                           \
+    assert(data != NULL);                                          \
+    memset(data, 0x5A, block * sizeof(T));                         \
+    InitFn(&rb, capacity);                                         \
+    const uint32_t rounds = BENCH_BYTES / (block * sizeof(T));     \
+    for (uint32_t r = 0; r < 3; r++) { /* fault the pages in */    \
+      PushFn(&rb, data, block);                                    \
+      PopFn(&rb, data, block);                                     \
+    }                                                              \
+    double start = Now();                                          \
+    for (uint32_t r = 0; r < rounds; r++) {                        \
+      PushFn(&rb, data, block);                                    \
+      PopFn(&rb, data, block);                                     \
+    }                                                              \
+    double elapsed = Now() - start;                                \
+    printf(" %9.0f", BENCH_BYTES / elapsed / 1e6);                 \
+    ReleaseFn(&rb);                                                \
+    free(data);                                                    \
+  } while (0)
+
+static void Bench(void) {
+  printf("MB/s %9s %9s %9s %9s %9s\n", "size", "u8 (.c)", "u16 (2.c)", "u8", "u16");
+  for (uint32_t size = 64; size <= (64u << 20); size *= 4) {
+    RingBufferU8 c_u8;
+    RingBufferU16 c_u16;
+    RingU8 g_u8;
+    RingU16 g_u16;
+    printf("     %9u", size);
+    BENCH(c_u8, uint8_t, InitU8, PushU8, PopU8, ReleaseU8, size);
+    BENCH(c_u16, uint16_t, InitU16, PushU16, PopU16, ReleaseU16, size);
+    BENCH(g_u8, uint8_t, RingU8Init, RingU8Push, RingU8Pop, RingU8Release, size);
+    BENCH(g_u16, uint16_t, RingU16Init, RingU16Push, RingU16Pop, RingU16Release, size);
+    printf("\n");
+  }
+}
+
+int main() {
+  Test();
+  Bench();
+  puts("ok");
+  return 0;
+}
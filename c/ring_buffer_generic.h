@@ -0,0 +1,87 @@
+// Typed ring/circular buffer, one definition for any element type
+// Same semantics as ring_buffer.c (u8) and ring_buffer2.c (u16): Push
+// overwrites the oldest elements when full, Pop is all or nothing.
+// Differences:
+// - capacity is rounded up to a power of two and indexes are masked, no %;
+//   at most 2^31 elements
+// - storage is left uninitialized
+// - Push/Pop move whole blocks with at most two memcpy calls
+//
+// usage: RING_BUFFER_DEFINE(RingU16, uint16_t) declares the RingU16 type and
+// RingU16Init, RingU16Release, RingU16Empty, RingU16Count, RingU16Push and
+// RingU16Pop.
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_BUFFER_DEFINE(Name, T)                                                    \
+  typedef struct {                                                                     \
+    T* buf;                                                                            \
+    uint32_t capacity;                                                                 \
+    uint32_t mask;                                                                     \
+    uint32_t begin;                                                                    \
+    uint32_t length;                                                                   \
+  } Name;                                                                              \
+                                                                                       \
+  static inline void Name##Init(Name* rb, uint32_t capacity) {                         \
+    assert(rb != NULL);                                                                \
+    assert(capacity <= (UINT32_C(1) << 31)); /* or pow2 overflows */                   \
+    uint32_t pow2 = 1;                                                                 \
+    while (pow2 < capacity) pow2 <<= 1;                                                \
+    rb->buf = malloc((size_t)pow2 * sizeof(T));                                        \
+    assert(rb->buf != NULL);                                                           \
+    rb->capacity = pow2;                                                               \
+    rb->mask = pow2 - 1;                                                               \
+    rb->begin = 0;                                                                     \
+    rb->length = 0;                                                                    \
+  }                                                                                    \
+                                                                                       \
+  static inline void Name##Release(Name* rb) {                                         \
+    free(rb->buf);                                                                     \
+    rb->buf = NULL;                                                                    \
+    rb->capacity = 0;                                                                  \
+    rb->mask = 0;                                                                      \
+    rb->begin = 0;                                                                     \
+    rb->length = 0;                                                                    \
+  }                                                                                    \
+                                                                                       \
+  static inline _Bool Name##Empty(const Name* rb) { return rb->length == 0u; }         \
+                                                                                       \
+  static inline uint32_t Name##Count(const Name* rb) { return rb->length; }            \
+                                                                                       \
+  static inline _Bool Name##Push(Name* rb, const T data[], uint32_t data_length) {     \
+    assert(rb != NULL);                                                                \
+    if (data_length > rb->capacity) {                                                  \
+      return 0;                                                                        \
+    }                                                                                  \
+    const uint32_t end = (rb->begin + rb->length) & rb->mask;                          \
+    const uint32_t to_end = rb->capacity - end;                                        \
+    const uint32_t len = data_length < to_end ? data_length : to_end;                  \
+    memcpy(&rb->buf[end], data, (size_t)len * sizeof(T));                              \
+    memcpy(rb->buf, &data[len], (size_t)(data_length - len) * sizeof(T));              \
+    if (data_length > rb->capacity - rb->length) {                                     \
+      rb->length = rb->capacity;                                                       \
+      rb->begin = (end + data_length) & rb->mask;                                      \
+    } else {                                                                           \
+      rb->length += data_length;                                                       \
+    }                                                                                  \
+    return 1;                                                                          \
+  }                                                                                    \
+                                                                                       \
+  static inline _Bool Name##Pop(Name* rb, T data[], uint32_t data_length) {            \
+    assert(rb != NULL);                                                                \
+    if (data_length > rb->length) {                                                    \
+      return 0;                                                                        \
+    }                                                                                  \
+    const uint32_t to_end = rb->capacity - rb->begin;                                  \
+    const uint32_t len = data_length < to_end ? data_length : to_end;                  \
+    memcpy(data, &rb->buf[rb->begin], (size_t)len * sizeof(T));                        \
+    memcpy(&data[len], rb->buf, (size_t)(data_length - len) * sizeof(T));              \
+    rb->begin = (rb->begin + data_length) & rb->mask;                                  \
+    rb->length -= data_length;                                                         \
+    return 1;                                                                          \
+  }
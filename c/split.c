@@ -1,36 +1,443 @@
+// Tokenizer: splits a buffer at any of a set of delimiter characters and
+// returns (offset, length) spans into it, no allocation and no copy.
+// Delimiters are found 64 bytes at a time, SSE2 or AVX2 compare + movemask
+// per delimiter character (up to 8, more fall back to a lookup table),
+// giving a bit mask that TokenizerNext pops one field at a time and
+// TokenizerRead a batch at a time.
+// Streaming: a field cut by the end of a buffer is not returned until the
+// buffer it ends in is fed, see TokenizerFeed.
+// compile: gcc -O2 -Wall -Wextra split.c
+// usage: split [--bench]
+
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPLIT_X86 1
+#endif
+
+#define DELIMS_SIMD_MAX 8
+#define BLOCK 64
+
+typedef struct Delims Delims;
+typedef uint64_t (*block_mask_fn)(const char* p, const Delims* d);
+
+struct Delims {
+	char chars[DELIMS_SIMD_MAX];
+	int count;
+	bool table[256];
+	block_mask_fn block_mask;
+};
+
+typedef struct {
+	size_t offset;
+	size_t length;
+} Span;
+
+typedef struct {
+	const Delims* delims;
+	const char* data;
+	size_t size;
+	size_t block;       // start of the block `mask` covers
+	uint64_t mask;      // delimiters of that block not returned yet
+	size_t field_start; // where the next field begins
+	bool last;          // no more data after this buffer
+	bool done;          // final field returned
+	bool seen;          // the stream had any bytes at all
+} Tokenizer;
+
+// bit i set when p[i] is a delimiter, i < n
+static uint64_t TableMask(const char* p, size_t n, const Delims* d) {
+	uint64_t mask = 0;
+	for (size_t i = 0; i < n; ++i) {
+		mask |= (uint64_t)d->table[(uint8_t)p[i]] << i;
+	}
+	return mask;
+}
+
+static uint64_t TableBlockMask(const char* p, const Delims* d) {
+	return TableMask(p, BLOCK, d);
+}
+
+#ifdef SPLIT_X86
+
+static uint64_t Sse2BlockMask(const char* p, const Delims* d) {
+	__m128i a = _mm_loadu_si128((const __m128i*)p);
+	__m128i b = _mm_loadu_si128((const __m128i*)(p + 16));
+	__m128i c = _mm_loadu_si128((const __m128i*)(p + 32));
+	__m128i e = _mm_loadu_si128((const __m128i*)(p + 48));
+	__m128i ma = _mm_setzero_si128(), mb = ma, mc = ma, me = ma;
+	for (int k = 0; k < d->count; ++k) {
+		__m128i ch = _mm_set1_epi8(d->chars[k]);
+		ma = _mm_or_si128(ma, _mm_cmpeq_epi8(a, ch));
+		mb = _mm_or_si128(mb, _mm_cmpeq_epi8(b, ch));
+		mc = _mm_or_si128(mc, _mm_cmpeq_epi8(c, ch));
+		me = _mm_or_si128(me, _mm_cmpeq_epi8(e, ch));
+	}
+	return (uint64_t)(uint16_t)_mm_movemask_epi8(ma) |
+	       (uint64_t)(uint16_t)_mm_movemask_epi8(mb) << 16 |
+	       (uint64_t)(uint16_t)_mm_movemask_epi8(mc) << 32 |
+	       (uint64_t)(uint16_t)_mm_movemask_epi8(me) << 48;
+}
+
+__attribute__((target("avx2")))
+static uint64_t Avx2BlockMask(const char* p, const Delims* d) {
+	__m256i a = _mm256_loadu_si256((const __m256i*)p);
+	__m256i b = _mm256_loadu_si256((const __m256i*)(p + 32));
+	__m256i ma = _mm256_setzero_si256(), mb = ma;
+	for (int k = 0; k < d->count; ++k) {
+		__m256i ch = _mm256_set1_epi8(d->chars[k]);
+		ma = _mm256_or_si256(ma, _mm256_cmpeq_epi8(a, ch));
+		mb = _mm256_or_si256(mb, _mm256_cmpeq_epi8(b, ch));
+	}
+	return (uint64_t)(uint32_t)_mm256_movemask_epi8(ma) |
+	       (uint64_t)(uint32_t)_mm256_movemask_epi8(mb) << 32;
+}
+
+#endif
+
+// set: the delimiter characters, e.g. ":" or ",;\t"
+void DelimsInit(Delims* d, const char* set) {
+	assert(d && set && *set);
+	memset(d, 0, sizeof(*d));
+	for (const char* c = set; *c; ++c) {
+		if (d->table[(uint8_t)*c]) continue;
+		d->table[(uint8_t)*c] = true;
+		if (d->count < DELIMS_SIMD_MAX) d->chars[d->count] = *c;
+		d->count++;
+	}
+	d->block_mask = TableBlockMask;
+#ifdef SPLIT_X86
+	if (d->count <= DELIMS_SIMD_MAX) {
+		__builtin_cpu_init();
+		d->block_mask = __builtin_cpu_supports("avx2") ? Avx2BlockMask : Sse2BlockMask;
+	}
+#endif
+}
+
+void TokenizerInit(Tokenizer* t, const Delims* d) {
+	memset(t, 0, sizeof(*t));
+	t->delims = d;
+}
+
+// Hands the tokenizer its next buffer; spans returned by TokenizerNext are
+// offsets into it. Except for the first call, data must start with the
+// bytes the previous buffer did not consume (see TokenizerConsumed)
+// followed by new input; those are not scanned again. last: the input
+// ends with this buffer, so its final field is returned as well.
+void TokenizerFeed(Tokenizer* t, const char* data, size_t size, bool last) {
+	size_t carried = t->data ? t->size - t->field_start : 0;
+	assert(carried <= size);
+	t->data = data;
+	t->size = size;
+	t->block = carried;
+	t->mask = 0;
+	t->field_start = 0;
+	t->last = last;
+	t->seen |= size > 0;
+	if (carried < size) {
+		size_t n = size - carried;
+		t->mask = n >= BLOCK ? t->delims->block_mask(data + carried, t->delims)
+		                     : TableMask(data + carried, n, t->delims);
+	}
+}
+
+bool TokenizerNext(Tokenizer* t, Span* span) {
+	while (t->mask == 0) {
+		t->block += BLOCK;
+		if (t->block >= t->size) {
+			t->block = t->size;
+			if (!t->last || t->done || !t->seen) return false;
+			t->done = true;
+			span->offset = t->field_start;
+			span->length = t->size - t->field_start;
+			return true;
+		}
+		size_t n = t->size - t->block;
+		t->mask = n >= BLOCK ? t->delims->block_mask(t->data + t->block, t->delims)
+		                     : TableMask(t->data + t->block, n, t->delims);
+	}
+	size_t pos = t->block + (size_t)__builtin_ctzll(t->mask);
+	t->mask &= t->mask - 1;
+	span->offset = t->field_start;
+	span->length = pos - t->field_start;
+	t->field_start = pos + 1;
+	return true;
+}
+
+// Up to max spans at once, 0 when TokenizerNext would return false.
+// While there is room for a whole block of spans, the first 8 delimiters of
+// a block are turned into spans without a branch per field (entries past
+// the real count are scratch), so short fields don't cost a mispredicted
+// loop exit each block.
+size_t TokenizerRead(Tokenizer* t, Span* spans, size_t max) {
+	size_t n = 0;
+	uint64_t mask = t->mask;
+	size_t block = t->block;
+	size_t field_start = t->field_start;
+	while (n < max) {
+		if (mask == 0) {
+			if (block + BLOCK >= t->size) break;
+			block += BLOCK;
+			mask = t->size - block >= BLOCK ? t->delims->block_mask(t->data + block, t->delims)
+			                                : TableMask(t->data + block, t->size - block, t->delims);
+			continue;
+		}
+		if (max - n >= BLOCK) {
+			Span* out = spans + n;
+			size_t count = (size_t)__builtin_popcountll(mask);
+			size_t start = field_start;
+			for (int k = 0; k < 8; ++k) {
+				size_t pos = block + (size_t)__builtin_ctzll(mask | 1ull << 63);
+				out[k].offset = start;
+				out[k].length = pos - start;
+				start = pos + 1;
+				mask &= mask - 1;
+			}
+			for (size_t k = 8; k < count; ++k) {
+				size_t pos = block + (size_t)__builtin_ctzll(mask);
+				out[k].offset = start;
+				out[k].length = pos - start;
+				start = pos + 1;
+				mask &= mask - 1;
+			}
+			field_start = out[count - 1].offset + out[count - 1].length + 1;
+			n += count;
+			continue;
+		}
+		size_t pos = block + (size_t)__builtin_ctzll(mask);
+		mask &= mask - 1;
+		spans[n].offset = field_start;
+		spans[n].length = pos - field_start;
+		field_start = pos + 1;
+		++n;
+	}
+	t->mask = mask;
+	t->block = block;
+	t->field_start = field_start;
+	if (n < max && TokenizerNext(t, &spans[n])) ++n;
+	return n;
+}
+
+// bytes of the current buffer that are done with; the rest is the start of
+// a field that continues in the next buffer
+size_t TokenizerConsumed(const Tokenizer* t) {
+	return t->field_start;
+}
 
+// number of ':' separated fields, 0 for NULL or ""
 int split(const char* data) {
-	if (!data || strlen(data) == 0) return 0;
+	if (!data) return 0;
+	Delims d;
+	DelimsInit(&d, ":");
+	Tokenizer t;
+	TokenizerInit(&t, &d);
+	TokenizerFeed(&t, data, strlen(data), true);
 	int i = 0;
-	char* temp = strdup(data);
-	char* curr = temp;
+	Span s;
+	while (TokenizerNext(&t, &s)) ++i;
+	return i;
+}
+
+// all fields of text, fed in chunks of `chunk` bytes through a buffer of
+// `capacity`, as "field|field|..." into out
+static void SplitStreamed(const char* text, const char* set, size_t chunk, size_t capacity, char* out) {
+	Delims d;
+	DelimsInit(&d, set);
+	Tokenizer t;
+	TokenizerInit(&t, &d);
+	char* buffer = malloc(capacity);
+	size_t len = strlen(text), fed = 0, kept = 0;
+	*out = '\0';
+	do {
+		size_t n = len - fed < chunk ? len - fed : chunk;
+		assert(kept + n <= capacity);
+		memcpy(buffer + kept, text + fed, n);
+		fed += n;
+		TokenizerFeed(&t, buffer, kept + n, fed == len);
+		Span s;
+		while (TokenizerNext(&t, &s)) {
+			strncat(out, buffer + s.offset, s.length);
+			strcat(out, "|");
+		}
+		size_t consumed = TokenizerConsumed(&t);
+		kept = kept + n - consumed;
+		memmove(buffer, buffer + consumed, kept);
+	} while (fed < len);
+	free(buffer);
+}
+
+static void Test(void) {
+	// every field boundary around the 64 byte blocks, all three mask paths
+	char text[300];
+	for (int k = 0; k < 3; ++k) {
+		const char* set = k == 0 ? ":" : k == 1 ? ":,\n" : "0123456789:";
+		for (size_t len = 0; len < sizeof(text); ++len) {
+			for (size_t i = 0; i < len; ++i) {
+				text[i] = "ab:c,\nde::f9"[(i * 7 + len) % 12];
+			}
+			text[len] = '\0';
+			Delims d;
+			DelimsInit(&d, set);
+			Tokenizer t;
+			TokenizerInit(&t, &d);
+			TokenizerFeed(&t, text, len, true);
+			size_t start = 0, fields = 0;
+			Span s;
+			while (TokenizerNext(&t, &s)) {
+				assert(s.offset == start);
+				size_t end = start;
+				while (end < len && !strchr(set, text[end])) ++end;
+				assert(s.length == end - start);
+				start = end + 1;
+				++fields;
+			}
+			size_t expected = len > 0;
+			for (size_t i = 0; i < len; ++i) expected += strchr(set, text[i]) != NULL;
+			assert(fields == expected);
 
-	while (curr) {
-		char* next = strchr(curr + 1, ':');
-		if (next) {
-			*next = '\0';
-			next++;
+			// batches give the same spans, small ones take the per-field path
+			Span one[sizeof(text) + 1], batch[sizeof(text) + 70];
+			TokenizerInit(&t, &d);
+			TokenizerFeed(&t, text, len, true);
+			for (size_t k = 0; k < fields; ++k) TokenizerNext(&t, &one[k]);
+			TokenizerInit(&t, &d);
+			TokenizerFeed(&t, text, len, true);
+			size_t got = 0, n, max = 1 + len % 70;
+			while ((n = TokenizerRead(&t, batch + got, max)) > 0) got += n;
+			assert(got == fields);
+			assert(memcmp(one, batch, fields * sizeof(Span)) == 0);
 		}
-		printf("%s ", curr);
-		++i;
+	}
+
+	// streaming gives the same fields for any chunking
+	const char* dump = "root:x:0:0:root:/root:/bin/bash\n"
+	                   "daemon:x:1:1:daemon:/usr/sbin:/usr/sbin/nologin\n"
+	                   "bin:x:2:2:bin:/bin:/usr/sbin/nologin\n"
+	                   "::\n";
+	static char whole[1024], streamed[1024];
+	SplitStreamed(dump, ":\n", strlen(dump), strlen(dump), whole);
+	for (size_t chunk = 1; chunk < 100; ++chunk) {
+		SplitStreamed(dump, ":\n", chunk, chunk + 64, streamed);
+		assert(strcmp(whole, streamed) == 0);
+	}
+	assert(strncmp(whole, "root|x|0|0|root|/root|/bin/bash|daemon|", 39) == 0);
+	assert(strcmp(whole + strlen(whole) - 5, "|||||") == 0);
+}
+
+static double now_sec(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// what split() did before, minus the printf: strdup and strchr per field
+static size_t CountStrchr(const char* data) {
+	char* temp = strdup(data);
+	size_t fields = 0;
+	for (char* curr = temp; curr; ++fields) {
+		char* next = strchr(curr, ':');
+		if (next) *next++ = '\0';
 		curr = next;
 	}
-	printf("\n");
 	free(temp);
-	return i;	
-}
-
-int main() {
-	const char* str1 = "a1:b2:c3:d4";
-	const char* str2 = "abc";
-	const char* str3 = (char*) 0;
-	const char* str4 = "";
-	assert(split(str3) == 0);
-	assert(split(str2) == 1);
-	assert(split(str1) == 4);
-	assert(split(str4) == 0);
-}
\ No newline at end of file
+	return fields;
+}
+
+static size_t CountTokens(const char* data, size_t size, block_mask_fn fn, const char* set) {
+	Delims d;
+	DelimsInit(&d, set);
+	if (fn) d.block_mask = fn;
+	Tokenizer t;
+	TokenizerInit(&t, &d);
+	TokenizerFeed(&t, data, size, true);
+	size_t fields = 0, sum = 0, n;
+	Span spans[256];
+	while ((n = TokenizerRead(&t, spans, 256)) > 0) {
+		for (size_t k = 0; k < n; ++k) sum += spans[k].length;
+		fields += n;
+	}
+	assert(sum + fields - 1 == size);
+	return fields;
+}
+
+static void Bench(void) {
+	// passwd-like records, 7 fields of 0 to 19 bytes
+	const size_t size = 64u << 20;
+	char* dump = malloc(size + 1);
+	assert(dump);
+	uint32_t x = 1;
+	size_t i = 0;
+	while (i < size) {
+		for (int f = 0; f < 7 && i < size; ++f) {
+			x = x * 1664525u + 1013904223u;
+			for (uint32_t n = x >> 27 & 15; n > 0 && i < size; --n) dump[i++] = 'a' + (x >> (n + 4) & 15);
+			if (i < size) dump[i++] = f == 6 ? '\n' : ':';
+		}
+	}
+	dump[size] = '\0';
+	for (i = 0; i < size; ++i) {
+		if (dump[i] == '\n') dump[i] = ':';  // the strchr baseline knows only ':'
+	}
+
+	struct {
+		const char* name;
+		block_mask_fn fn;
+		const char* set;
+		bool supported;
+	} runs[] = {
+		{ "table, \":\"", TableBlockMask, ":", true },
+#ifdef SPLIT_X86
+		{ "sse2, \":\"", Sse2BlockMask, ":", true },
+		{ "avx2, \":\"", Avx2BlockMask, ":", __builtin_cpu_supports("avx2") },
+		{ "sse2, \":\\n,;\"", Sse2BlockMask, ":\n,;", true },
+		{ "avx2, \":\\n,;\"", Avx2BlockMask, ":\n,;", __builtin_cpu_supports("avx2") },
+#endif
+	};
+	double start = now_sec();
+	size_t expected = CountStrchr(dump);
+	printf("%-22s %8.2f GB/s\n", "strdup + strchr", size / (now_sec() - start) / 1e9);
+	for (size_t k = 0; k < sizeof(runs) / sizeof(runs[0]); ++k) {
+		if (!runs[k].supported) continue;
+		const int rounds = 5;
+		start = now_sec();
+		for (int r = 0; r < rounds; ++r) {
+			// outside the assert, so an NDEBUG build still does the work
+			size_t fields = CountTokens(dump, size, runs[k].fn, runs[k].set);
+			assert(fields == expected);
+			(void)fields;
+		}
+		printf("%-22s %8.2f GB/s\n", runs[k].name, (double)size * rounds / (now_sec() - start) / 1e9);
+	}
+	printf("%zu fields, %.1f bytes per field\n", expected, (double)size / expected);
+	free(dump);
+}
+
+int main(int argc, char** argv) {
+	if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+		Bench();
+		return 0;
+	}
+	static const struct {
+		const char* str;
+		int fields;
+	} cases[] = {
+		{ (char*) 0, 0 },
+		{ "abc", 1 },
+		{ "a1:b2:c3:d4", 4 },
+		{ "", 0 },
+	};
+	for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+		int fields = split(cases[k].str);
+		assert(fields == cases[k].fields);
+		(void)fields;
+	}
+	Test();
+	puts("ok");
+}
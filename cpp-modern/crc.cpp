@@ -0,0 +1,76 @@
+// g++ -O3 -msse4.2 -std=c++17 -Wall -Wextra crc.cpp
+
+#include "crc.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+template <typename Crc>
+typename Crc::value_type check(const char* s) {
+  return Crc::compute(s, std::strlen(s));
+}
+
+void test_crc() {
+  // same results as the C versions
+  const uint8_t ff[] = {0xFF};
+  assert(0x3C == crc8_97::compute(ff, sizeof(ff)));
+  assert(0x60 == check<crc8_97>("abc"));
+
+  const uint8_t one[] = {1};
+  const uint8_t frame[] = {0x47, 1, 5, 0, 0, 0, 0, 0, 1};
+  assert(0xD175 == crc16_d175::compute(one, sizeof(one)));
+  assert(0xFCBE == crc16_d175::compute(frame, sizeof(frame)));
+  assert(0x713C == check<crc16_d175>("abc"));
+
+  assert(0x0A9421B7 == check<crc32c>("abcdefgh"));
+
+  // catalogue check values
+  const char* digits = "123456789";
+  using crc8_smbus = crc<8, 0x07, 0, 0, false>;
+  assert(0xF4 == check<crc8_smbus>(digits));
+  assert(0x29B1 == check<crc16_ccitt_false>(digits));
+  assert(0xE3069283 == check<crc32c>(digits));
+  assert(0xCBF43926 == check<crc32_ieee>(digits));
+  assert(0x995DC9BBDF1939FAull == check<crc64_xz>(digits));
+
+  // incremental updates match one-shot, across the slice boundaries
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = uint8_t(i * 131 + 7);
+  for (size_t split : {0, 1, 7, 8, 9, 500, 1000}) {
+    crc16_ccitt_false c;
+    c.update(data.data(), split);
+    c.update(data.data() + split, data.size() - split);
+    assert(c.value() == crc16_ccitt_false::compute(data.data(), data.size()));
+  }
+  assert(crc64_xz::update_bytewise(~0ull, data.data(), data.size()) ==
+         crc64_xz::update(~0ull, data.data(), data.size()));
+  assert(crc32c::update_bytewise(~0u, data.data(), data.size()) ==
+         crc32c::update(~0u, data.data(), data.size()));
+}
+
+template <typename Crc>
+void bench(const char* name, const std::vector<uint8_t>& data) {
+  const int rounds = 10;
+  typename Crc::value_type sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) sum += Crc::compute(data.data(), data.size());
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  std::cout << name << ": " << data.size() * rounds / seconds / 1e6
+            << " MB/s (" << uint64_t(sum) << ")" << std::endl;
+}
+
+int main() {
+  test_crc();
+
+  std::vector<uint8_t> data(16 << 20);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = uint8_t(i * 2654435761u >> 24);
+  bench<crc8_97>("crc8_97", data);
+  bench<crc16_d175>("crc16_d175", data);
+  bench<crc32c>("crc32c", data);
+  bench<crc32_ieee>("crc32_ieee", data);
+  bench<crc64_xz>("crc64_xz", data);
+}
@@ -0,0 +1,200 @@
+/*
+ Generic CRC, parameterized like the "Rocksoft" model:
+   Width     - 8, 16, 32 or 64 bits
+   Poly      - normal (not reversed) polynomial, e.g. 0x1EDC6F41 for CRC-32C
+   Init      - initial register value
+   XorOut    - value xor'ed into the final register
+   Reflected - true for LSB-first CRCs (refin = refout)
+
+ Slice-by-8 tables are generated at compile time, so new variants need no
+ pasted table and no make_table() at startup. CRC-32C uses the SSE4.2 crc32
+ instruction when compiled with -msse4.2.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+template <unsigned Width, uint64_t Poly, uint64_t Init, uint64_t XorOut,
+          bool Reflected>
+class crc {
+  static_assert(Width == 8 || Width == 16 || Width == 32 || Width == 64,
+                "unsupported CRC width");
+
+ public:
+  using value_type = std::conditional_t<
+      Width == 8, uint8_t,
+      std::conditional_t<Width == 16, uint16_t,
+                         std::conditional_t<Width == 32, uint32_t, uint64_t>>>;
+
+  static constexpr size_t slices = 8;
+
+  crc() noexcept : reg_{static_cast<value_type>(Init)} {}
+
+  void update(const void* data, size_t size) noexcept {
+    reg_ = update(reg_, static_cast<const uint8_t*>(data), size);
+  }
+
+  value_type value() const noexcept {
+    return static_cast<value_type>(reg_ ^ XorOut);
+  }
+
+  // one-shot checksum
+  static value_type compute(const void* data, size_t size) noexcept {
+    crc c;
+    c.update(data, size);
+    return c.value();
+  }
+
+  // raw register update, no init/xorout
+  static value_type update(value_type reg, const uint8_t* p,
+                           size_t size) noexcept {
+    if constexpr (hardware) {
+      return update_hw(reg, p, size);
+    } else {
+      return update_slice(reg, p, size);
+    }
+  }
+
+  static value_type update_bytewise(value_type reg, const uint8_t* p,
+                                    size_t size) noexcept {
+    for (size_t i = 0; i < size; ++i) reg = step(reg, p[i]);
+    return reg;
+  }
+
+ private:
+  static constexpr value_type mask = static_cast<value_type>(~value_type{0});
+
+  static constexpr value_type reflect(value_type v) {
+    value_type r = 0;
+    for (unsigned i = 0; i < Width; ++i) {
+      r = static_cast<value_type>((r << 1) | ((v >> i) & 1));
+    }
+    return r;
+  }
+
+  static constexpr value_type poly = Reflected
+                                         ? reflect(static_cast<value_type>(Poly))
+                                         : static_cast<value_type>(Poly);
+
+#ifdef __SSE4_2__
+  static constexpr bool hardware =
+      Width == 32 && Poly == 0x1EDC6F41u && Reflected;
+#else
+  static constexpr bool hardware = false;
+#endif
+
+  using table_type = std::array<std::array<value_type, 256>, slices>;
+
+  static constexpr table_type make_tables() {
+    table_type t{};
+    for (unsigned i = 0; i < 256; ++i) {
+      value_type reg = 0;
+      if constexpr (Reflected) {
+        reg = static_cast<value_type>(i);
+        for (int j = 0; j < 8; ++j) {
+          reg = (reg & 1) ? static_cast<value_type>((reg >> 1) ^ poly)
+                          : static_cast<value_type>(reg >> 1);
+        }
+      } else {
+        reg = static_cast<value_type>(static_cast<value_type>(i) << (Width - 8));
+        for (int j = 0; j < 8; ++j) {
+          const bool top = (reg >> (Width - 1)) & 1;
+          reg = static_cast<value_type>(reg << 1);
+          if (top) reg ^= poly;
+        }
+      }
+      t[0][i] = reg;
+    }
+    // t[k][i]: byte i followed by k zero bytes
+    for (size_t k = 1; k < slices; ++k) {
+      for (unsigned i = 0; i < 256; ++i) {
+        t[k][i] = step(t[k - 1][i], 0, t[0]);
+      }
+    }
+    return t;
+  }
+
+  static constexpr value_type step(value_type reg, uint8_t byte,
+                                   const std::array<value_type, 256>& t0) {
+    if constexpr (Width == 8) {
+      return t0[reg ^ byte];
+    } else if constexpr (Reflected) {
+      return static_cast<value_type>((reg >> 8) ^ t0[(reg ^ byte) & 0xFF]);
+    } else {
+      return static_cast<value_type>(
+          (reg << 8) ^ t0[((reg >> (Width - 8)) ^ byte) & 0xFF]);
+    }
+  }
+
+  static constexpr table_type table = make_tables();
+
+  static value_type step(value_type reg, uint8_t byte) noexcept {
+    return step(reg, byte, table[0]);
+  }
+
+  // The register is folded into the first Width / 8 bytes of each 8-byte
+  // block, then every byte goes through the table of the zeros that follow it.
+  static value_type update_slice(value_type reg, const uint8_t* p,
+                                 size_t size) noexcept {
+    constexpr unsigned bytes = Width / 8;
+    while (size >= slices) {
+      uint8_t b[slices];
+      std::memcpy(b, p, slices);
+      for (unsigned i = 0; i < bytes; ++i) {
+        if constexpr (Reflected) {
+          b[i] ^= static_cast<uint8_t>(reg >> (8 * i));
+        } else {
+          b[i] ^= static_cast<uint8_t>(reg >> (Width - 8 - 8 * i));
+        }
+      }
+      value_type r = 0;
+      for (size_t i = 0; i < slices; ++i) {
+        r ^= table[slices - 1 - i][b[i]];
+      }
+      reg = r;
+      p += slices;
+      size -= slices;
+    }
+    return update_bytewise(reg, p, size);
+  }
+
+#ifdef __SSE4_2__
+  static value_type update_hw(value_type reg, const uint8_t* p,
+                              size_t size) noexcept {
+    uint64_t r = reg;
+    for (; size >= 8; size -= 8, p += 8) {
+      uint64_t w;
+      std::memcpy(&w, p, 8);
+      r = _mm_crc32_u64(r, w);
+    }
+    for (; size; --size) r = _mm_crc32_u8(static_cast<uint32_t>(r), *p++);
+    return static_cast<value_type>(r);
+  }
+#else
+  static value_type update_hw(value_type reg, const uint8_t* p,
+                              size_t size) noexcept {
+    return update_slice(reg, p, size);
+  }
+#endif
+
+  value_type reg_;
+};
+
+// variants used in this repo (see c/crc8.c, c/crc16.c and c/crc32.c)
+using crc8_97 = crc<8, 0x97, 0, 0, false>;
+using crc16_d175 = crc<16, 0xD175, 0, 0, false>;
+using crc32c = crc<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true>;
+
+// common protocol CRCs
+using crc16_ccitt_false = crc<16, 0x1021, 0xFFFF, 0, false>;
+using crc32_ieee = crc<32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, true>;
+using crc64_xz = crc<64, 0x42F0E1EBA9EA3693, ~0ull, ~0ull, true>;
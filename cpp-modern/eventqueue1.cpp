@@ -1,18 +1,28 @@
+// g++ -O2 -std=c++17 -Wall -Wextra -pthread eventqueue1.cpp
+
 #include <atomic>
-#include <functional>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
-#include "semaphore.h"
+#include <vector>
+#include "unique_function.h"
 
 namespace x {
 
 class EventQueue {
 public:
-	typedef std::function<void()> Closure;
+	// captures up to 64 bytes never allocate
+	typedef unique_function<void(), 64> Closure;
 
-	EventQueue() : running_(true), t_(&EventQueue::run, this) {
+	// closures are kept in a preallocated ring of slots (the slab), it only
+	// grows when more than `capacity` closures are pending
+	explicit EventQueue(size_t capacity = 1024)
+		: slab_(round_up(capacity)), head_(0), count_(0), spilled_(0), running_(true), t_(&EventQueue::run, this) {
 	}
 
 	~EventQueue() {
@@ -21,33 +31,64 @@ public:
 	}
 
 	void post(Closure closure) {
+		if (closure.on_heap()) {
+			spilled_.fetch_add(1, std::memory_order_relaxed);
+		}
 		{
 			std::lock_guard<std::mutex> lock(mtx_);
-			q_.push(closure);
+			if (count_ == slab_.size()) {
+				grow();
+			}
+			slab_[(head_ + count_) & (slab_.size() - 1)] = std::move(closure);
+			++count_;
 		}
-		s_.post();
+		cv_.notify_one();
+	}
+
+	// number of posted closures too big for the inline buffer
+	size_t spilled() const noexcept {
+		return spilled_.load(std::memory_order_relaxed);
 	}
 
 private:
 
+	static size_t round_up(size_t n) {
+		size_t pow2 = 1;
+		while (pow2 < n) pow2 <<= 1;
+		return pow2;
+	}
+
+	// called with mtx_ held
+	void grow() {
+		std::vector<Closure> bigger(slab_.size() * 2);
+		for (size_t i = 0; i < count_; ++i) {
+			bigger[i] = std::move(slab_[(head_ + i) & (slab_.size() - 1)]);
+		}
+		slab_.swap(bigger);
+		head_ = 0;
+	}
+
 	void run() {
 		std::cout << __PRETTY_FUNCTION__ << " worker thread: " << std::this_thread::get_id() << std::endl;
 		do {
-			mtx_.lock();
-			if (!q_.empty()) {
-				auto f = q_.front();
-				q_.pop();
-				mtx_.unlock();
-				f();
+			Closure f;
+			{
+				std::unique_lock<std::mutex> lock(mtx_);
+				cv_.wait(lock, [this]{ return count_ > 0; });
+				f = std::move(slab_[head_]);
+				head_ = (head_ + 1) & (slab_.size() - 1);
+				--count_;
 			}
-			mtx_.unlock();
-			s_.wait();
+			f();
 		} while (running_.load());
 	}
 
-	std::queue<Closure> q_;
-	Semaphore s_;
+	std::vector<Closure> slab_;
+	size_t head_;
+	size_t count_;
+	std::atomic<size_t> spilled_;
 	std::mutex mtx_;
+	std::condition_variable cv_;
 	std::atomic_bool running_;
 	std::thread t_;
 };
@@ -58,11 +99,26 @@ int main() {
 
 	std::cout  << __PRETTY_FUNCTION__ << " main thread: " << std::this_thread::get_id() << std::endl;
 
+	std::atomic<int> ticks(0); // outlives eq, which runs what is left on exit
 	x::EventQueue eq;
 	eq.post([]{ std::cout << "1" << std::endl; });
 	eq.post([]{ std::cout << "2" << std::endl; });
 	eq.post([]{ std::cout << "3" << std::endl; });
 
+	// steady state: small captures stay in the slab, nothing spills
+	for (int i = 0; i < 10000; ++i) {
+		eq.post([&ticks, i]{ ticks += i & 1; });
+	}
+	assert(eq.spilled() == 0);
+
+	// move-only and large captures
+	std::unique_ptr<int> p(new int(4));
+	eq.post([p = std::move(p)]{ std::cout << *p << std::endl; });
+	std::string big(100, '5');
+	char bytes[128] = {};
+	eq.post([big, bytes]{ std::cout << big.substr(0, 1) << sizeof(bytes) << std::endl; });
+	std::cout << "spilled to heap: " << eq.spilled() << std::endl;
+
 	return 0;
 }
 
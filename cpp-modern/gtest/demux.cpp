@@ -0,0 +1,166 @@
+#include "demux.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "../crc.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DEMUX_X86 1
+#endif
+
+namespace {
+
+uint16_t load16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+
+uint32_t load32(const uint8_t* p) {
+  return uint32_t{p[0]} | uint32_t{p[1]} << 8 | uint32_t{p[2]} << 16 | uint32_t{p[3]} << 24;
+}
+
+// the part of find_sync after the vector loop stopped at i
+size_t find_tail(const uint8_t* p, size_t i, size_t n, uint8_t s0, uint8_t s1) {
+  for (; i + 1 < n; ++i) {
+    if (p[i] == s0 && p[i + 1] == s1) return i;
+  }
+  return n > 0 && p[n - 1] == s0 ? n - 1 : n;
+}
+
+}  // namespace
+
+demux::demux(size_t streams, uint8_t sync0, uint8_t sync1)
+    : streams_(streams), sync0_{sync0}, sync1_{sync1}, find_{find_scalar} {
+#ifdef DEMUX_X86
+  find_ = __builtin_cpu_supports("avx2") ? find_avx2 : find_sse2;
+#endif
+}
+
+void demux::attach(size_t stream, const callback* cb) {
+  assert(stream < streams_.size());
+  streams_[stream].cb = cb;
+}
+
+void demux::frame(const uint8_t* payload, uint16_t length, std::vector<uint8_t>& out, uint8_t sync0,
+                  uint8_t sync1) {
+  const size_t at = out.size();
+  out.resize(at + header_size + length + trailer_size);
+  uint8_t* p = &out[at];
+  p[0] = sync0;
+  p[1] = sync1;
+  p[2] = static_cast<uint8_t>(length);
+  p[3] = static_cast<uint8_t>(length >> 8);
+  if (length > 0) std::memcpy(p + header_size, payload, length);
+  const uint32_t crc = crc32c::compute(p + 2, 2 + length);
+  for (int i = 0; i < 4; ++i) p[header_size + length + i] = static_cast<uint8_t>(crc >> 8 * i);
+}
+
+size_t demux::find_sync(const uint8_t* p, size_t n) const { return find_(p, n, sync0_, sync1_); }
+
+size_t demux::find_scalar(const uint8_t* p, size_t n, uint8_t s0, uint8_t s1) {
+  return find_tail(p, 0, n, s0, s1);
+}
+
+#ifdef DEMUX_X86
+
+// compares 16 bytes against sync0 and the same 16 shifted by one against
+// sync1, a set bit in both masks is a sync word
+size_t demux::find_sse2(const uint8_t* p, size_t n, uint8_t s0, uint8_t s1) {
+  const __m128i v0 = _mm_set1_epi8(static_cast<char>(s0));
+  const __m128i v1 = _mm_set1_epi8(static_cast<char>(s1));
+  size_t i = 0;
+  for (; i + 17 <= n; i += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 1));
+    const unsigned m = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, v0), _mm_cmpeq_epi8(b, v1))));
+    if (m) return i + __builtin_ctz(m);
+  }
+  return find_tail(p, i, n, s0, s1);
+}
+
+__attribute__((target("avx2"))) size_t demux::find_avx2(const uint8_t* p, size_t n, uint8_t s0,
+                                                        uint8_t s1) {
+  const __m256i v0 = _mm256_set1_epi8(static_cast<char>(s0));
+  const __m256i v1 = _mm256_set1_epi8(static_cast<char>(s1));
+  size_t i = 0;
+  for (; i + 33 <= n; i += 32) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 1));
+    const unsigned m = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, v0), _mm256_cmpeq_epi8(b, v1))));
+    if (m) return i + __builtin_ctz(m);
+  }
+  return find_sse2(p + i, n - i, s0, s1) + i;
+}
+
+#else
+
+size_t demux::find_sse2(const uint8_t* p, size_t n, uint8_t s0, uint8_t s1) {
+  return find_scalar(p, n, s0, s1);
+}
+
+size_t demux::find_avx2(const uint8_t* p, size_t n, uint8_t s0, uint8_t s1) {
+  return find_scalar(p, n, s0, s1);
+}
+
+#endif
+
+// bytes to add to a staged partial frame before it can be scanned again:
+// up to the sync word, up to the length field, then up to the end of the
+// frame; none when a lone sync0 turned out not to start a sync word
+size_t demux::needed(const std::vector<uint8_t>& staging) const {
+  const size_t size = staging.size();
+  if (size < 2) return 2 - size;
+  if (staging[0] != sync0_ || staging[1] != sync1_) return 0;
+  if (size < header_size) return header_size - size;
+  return header_size + load16(&staging[2]) + trailer_size - size;
+}
+
+// delivers every whole frame in [p, p + n) and returns how many bytes were
+// consumed; the rest is the start of a frame (or of a sync word)
+size_t demux::scan(stream& s, const uint8_t* p, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    const size_t at = i + find_(p + i, n - i, sync0_, sync1_);
+    s.counters.skipped += at - i;
+    if (n - at < header_size) return at;
+    const size_t length = load16(p + at + 2);
+    const size_t end = at + header_size + length + trailer_size;
+    if (end > n) return at;
+    if (crc32c::compute(p + at + 2, 2 + length) == load32(p + at + header_size + length)) {
+      ++s.counters.frames;
+      s.counters.bytes += length;
+      if (s.cb) s.cb->fn(p + at + header_size, length);
+      i = end;
+    } else {
+      // a payload byte that looked like a sync word, or a damaged frame:
+      // look for the next sync word from the byte after
+      ++s.counters.crc_errors;
+      ++s.counters.skipped;
+      i = at + 1;
+    }
+  }
+  return n;
+}
+
+void demux::parse(size_t stream_id, const uint8_t* ptr, size_t n) {
+  assert(stream_id < streams_.size());
+  assert(ptr || n == 0);
+  stream& s = streams_[stream_id];
+  // the staged frame only ever takes the bytes it still needs, so whatever
+  // scan() leaves over is again an incomplete frame
+  while (!s.staging.empty() && n > 0) {
+    const size_t take = std::min(n, needed(s.staging));
+    s.staging.insert(s.staging.end(), ptr, ptr + take);
+    ptr += take;
+    n -= take;
+    if (needed(s.staging) == 0) {
+      const size_t consumed = scan(s, s.staging.data(), s.staging.size());
+      s.staging.erase(s.staging.begin(), s.staging.begin() + consumed);
+    }
+  }
+  if (n == 0) return;
+  const size_t consumed = scan(s, ptr, n);
+  s.staging.assign(ptr + consumed, ptr + n);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "gtest/gtest_prod.h"
+#include "callback.h"
+
+// Demultiplexes byte feeds from many streams at once. Each feed carries
+// frames of
+//
+//   sync0 sync1 | length (u16 le) | payload (length bytes) | crc32c (u32 le)
+//
+// where the CRC-32C covers the length field and the payload. Sync words are
+// found with SSE2/AVX2 byte compares, frames with a bad CRC are skipped one
+// byte at a time (resync), good payloads go to the stream's callback
+// straight from the caller's buffer. A frame split across two parse()
+// calls of a stream is staged in that stream's slot of a flat array.
+class demux {
+ public:
+  static const size_t header_size = 4;
+  static const size_t trailer_size = 4;
+
+  struct stats {
+    uint64_t frames = 0;      // delivered
+    uint64_t bytes = 0;       // payload bytes delivered
+    uint64_t crc_errors = 0;  // candidate frames that failed the CRC
+    uint64_t skipped = 0;     // bytes discarded while looking for a sync word
+  };
+
+  explicit demux(size_t streams, uint8_t sync0 = 0xA5, uint8_t sync1 = 0x5A);
+
+  // frames of `stream` go to cb (nullptr: counted and dropped)
+  void attach(size_t stream, const callback* cb);
+
+  void parse(size_t stream, const uint8_t* ptr, size_t n);
+
+  const stats& stream_stats(size_t stream) const { return streams_[stream].counters; }
+
+  // bytes staged for `stream` (the start of an incomplete frame)
+  size_t staged(size_t stream) const { return streams_[stream].staging.size(); }
+
+  // writes a frame for `payload` to out, for producers and tests
+  static void frame(const uint8_t* payload, uint16_t length, std::vector<uint8_t>& out,
+                    uint8_t sync0 = 0xA5, uint8_t sync1 = 0x5A);
+
+  // position of the first sync word in [p, p + n), n - 1 when only the last
+  // byte matches sync0 (it may be half a sync word), n when there is none
+  size_t find_sync(const uint8_t* p, size_t n) const;
+
+ private:
+  struct stream {
+    const callback* cb = nullptr;
+    std::vector<uint8_t> staging;
+    stats counters;
+  };
+
+  using finder = size_t (*)(const uint8_t*, size_t, uint8_t, uint8_t);
+
+  size_t scan(stream& s, const uint8_t* p, size_t n);
+  size_t needed(const std::vector<uint8_t>& staging) const;
+
+  // find_sync kernels, picked once by the constructor
+  static size_t find_scalar(const uint8_t* p, size_t n, uint8_t s0, uint8_t s1);
+  static size_t find_sse2(const uint8_t* p, size_t n, uint8_t s0, uint8_t s1);
+  static size_t find_avx2(const uint8_t* p, size_t n, uint8_t s0, uint8_t s1);
+
+  std::vector<stream> streams_;
+  const uint8_t sync0_;
+  const uint8_t sync1_;
+  finder find_;
+
+  FRIEND_TEST(demux, ScalarAndSimdAgree);
+};
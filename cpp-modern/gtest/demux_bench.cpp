@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "demux.h"
+
+// sustained frames/s and MB/s of the demultiplexer replaying a capture:
+//   ./demux_bench                   synthetic capture, 64 streams
+//   ./demux_bench capture.bin       a recorded one
+//   ./demux_bench --record file     writes the synthetic capture to file
+// a capture is the bytes as they arrived, one record per read:
+//   u16 stream, u32 size (host order), size bytes
+
+namespace {
+
+struct chunk {
+  uint16_t stream;
+  const uint8_t* data;
+  uint32_t size;
+};
+
+class counting_callback : public callback {
+ public:
+  void fn(const uint8_t* p, size_t n) const override { sum_ += n ? p[0] + n : 1; }
+  mutable size_t sum_ = 0;
+};
+
+// per stream a run of frames (16..1400 byte payloads, 1 in 200 damaged,
+// now and then a few bytes of line noise) cut into reads of 1..4096 bytes,
+// the reads of all streams interleaved at random
+std::vector<uint8_t> synthesize(size_t streams, size_t bytes_per_stream) {
+  std::mt19937 rng{1};
+  std::vector<std::vector<uint8_t>> feeds(streams);
+  std::vector<uint8_t> payload(1400);
+  for (auto& feed : feeds) {
+    while (feed.size() < bytes_per_stream) {
+      const uint16_t length = static_cast<uint16_t>(16 + rng() % (payload.size() - 16));
+      for (uint16_t i = 0; i < length; ++i) payload[i] = static_cast<uint8_t>(rng());
+      demux::frame(payload.data(), length, feed);
+      if (rng() % 200 == 0) feed[feed.size() - 1 - rng() % length] ^= 0x40;
+      if (rng() % 100 == 0) {
+        for (unsigned i = rng() % 16; i > 0; --i) feed.push_back(static_cast<uint8_t>(rng()));
+      }
+    }
+  }
+  std::vector<uint8_t> capture;
+  std::vector<size_t> sent(streams, 0);
+  size_t left = streams;
+  while (left > 0) {
+    const uint16_t s = static_cast<uint16_t>(rng() % streams);
+    const size_t remaining = feeds[s].size() - sent[s];
+    if (remaining == 0) continue;
+    const uint32_t size = static_cast<uint32_t>(std::min<size_t>(remaining, 1 + rng() % 4096));
+    const size_t at = capture.size();
+    capture.resize(at + 6 + size);
+    std::memcpy(&capture[at], &s, 2);
+    std::memcpy(&capture[at + 2], &size, 4);
+    std::memcpy(&capture[at + 6], &feeds[s][sent[s]], size);
+    sent[s] += size;
+    if (sent[s] == feeds[s].size()) --left;
+  }
+  return capture;
+}
+
+bool index(const std::vector<uint8_t>& capture, std::vector<chunk>& chunks, size_t& streams) {
+  streams = 0;
+  for (size_t at = 0; at < capture.size();) {
+    chunk c;
+    if (capture.size() - at < 6) return false;
+    std::memcpy(&c.stream, &capture[at], 2);
+    std::memcpy(&c.size, &capture[at + 2], 4);
+    if (capture.size() - at - 6 < c.size) return false;
+    c.data = &capture[at + 6];
+    chunks.push_back(c);
+    streams = std::max<size_t>(streams, c.stream + 1u);
+    at += 6 + c.size;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<uint8_t> capture;
+  if (argc == 2) {
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+      std::perror(argv[1]);
+      return 1;
+    }
+    capture.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  } else {
+    capture = synthesize(64, 512 * 1024);
+    if (argc == 3 && std::string(argv[1]) == "--record") {
+      std::ofstream out(argv[2], std::ios::binary);
+      out.write(reinterpret_cast<const char*>(capture.data()), static_cast<std::streamsize>(capture.size()));
+      return out ? 0 : 1;
+    }
+  }
+
+  std::vector<chunk> chunks;
+  size_t streams;
+  if (!index(capture, chunks, streams)) {
+    std::fprintf(stderr, "truncated capture\n");
+    return 1;
+  }
+  size_t bytes = 0;
+  for (const chunk& c : chunks) bytes += c.size;
+
+  counting_callback cb;
+  const int passes = 10;
+  demux::stats total;
+  double seconds = 0;
+  for (int pass = 0; pass <= passes; ++pass) {
+    demux d{streams};
+    for (size_t s = 0; s < streams; ++s) d.attach(s, &cb);
+    const auto start = std::chrono::steady_clock::now();
+    for (const chunk& c : chunks) d.parse(c.stream, c.data, c.size);
+    const auto stop = std::chrono::steady_clock::now();
+    if (pass == 0) continue;  // warm up
+    seconds += std::chrono::duration<double>(stop - start).count();
+    for (size_t s = 0; s < streams; ++s) {
+      total.frames += d.stream_stats(s).frames;
+      total.bytes += d.stream_stats(s).bytes;
+      total.crc_errors += d.stream_stats(s).crc_errors;
+      total.skipped += d.stream_stats(s).skipped;
+    }
+  }
+
+  std::printf("capture: %zu streams, %zu reads, %.1f MB\n", streams, chunks.size(), bytes / 1e6);
+  std::printf("per pass: %llu frames, %llu crc errors, %llu bytes skipped\n",
+              static_cast<unsigned long long>(total.frames / passes),
+              static_cast<unsigned long long>(total.crc_errors / passes),
+              static_cast<unsigned long long>(total.skipped / passes));
+  std::printf("%.2f Mframes/s, %.0f MB/s in, %.0f MB/s payload\n", total.frames / seconds / 1e6,
+              bytes * passes / seconds / 1e6, total.bytes / seconds / 1e6);
+  return cb.sum_ == 0;
+}
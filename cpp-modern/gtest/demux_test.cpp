@@ -0,0 +1,158 @@
+#include "demux.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <random>
+#include <string>
+#include "callback.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+
+MATCHER_P(PayloadIs, payload, "") {
+  return std::string(reinterpret_cast<const char*>(arg), payload.size()) == payload;
+}
+
+class mock_stream_callback : public callback {
+ public:
+  virtual ~mock_stream_callback() {}
+  MOCK_CONST_METHOD2(fn, void(const uint8_t*, size_t));
+};
+
+static void frame(const std::string& payload, std::vector<uint8_t>& out) {
+  demux::frame(reinterpret_cast<const uint8_t*>(payload.data()), static_cast<uint16_t>(payload.size()), out);
+}
+
+TEST(demux, OneFrame) {
+  mock_stream_callback mcb;
+  demux d{1};
+  d.attach(0, &mcb);
+  std::vector<uint8_t> data;
+  frame("hello", data);
+
+  // straight from the caller's buffer
+  EXPECT_CALL(mcb, fn(data.data() + demux::header_size, 5)).Times(1);
+
+  d.parse(0, data.data(), data.size());
+
+  ASSERT_EQ(1u, d.stream_stats(0).frames);
+  ASSERT_EQ(5u, d.stream_stats(0).bytes);
+  ASSERT_EQ(0u, d.staged(0));
+}
+
+TEST(demux, OneByteAtATime) {
+  mock_stream_callback mcb;
+  demux d{1};
+  d.attach(0, &mcb);
+  std::vector<uint8_t> data;
+  frame("first", data);
+  frame("", data);
+  frame("third frame", data);
+
+  {
+    InSequence seq;
+    EXPECT_CALL(mcb, fn(PayloadIs(std::string("first")), 5)).Times(1);
+    EXPECT_CALL(mcb, fn(_, 0)).Times(1);
+    EXPECT_CALL(mcb, fn(PayloadIs(std::string("third frame")), 11)).Times(1);
+  }
+
+  for (uint8_t byte : data) d.parse(0, &byte, 1);
+
+  ASSERT_EQ(3u, d.stream_stats(0).frames);
+  ASSERT_EQ(0u, d.stream_stats(0).skipped);
+  ASSERT_EQ(0u, d.staged(0));
+}
+
+TEST(demux, HalfFrameIsStaged) {
+  mock_stream_callback mcb;
+  demux d{1};
+  d.attach(0, &mcb);
+  std::vector<uint8_t> data;
+  frame("0123456789", data);
+
+  EXPECT_CALL(mcb, fn(PayloadIs(std::string("0123456789")), 10)).Times(1);
+
+  d.parse(0, data.data(), 7);
+  ASSERT_EQ(7u, d.staged(0));
+  d.parse(0, data.data() + 7, data.size() - 7);
+  ASSERT_EQ(0u, d.staged(0));
+}
+
+TEST(demux, SyncWordInPayload) {
+  mock_stream_callback mcb;
+  demux d{1};
+  d.attach(0, &mcb);
+  const std::string payload = "\xA5\x5A\x10\x00\xA5\x5A";
+  std::vector<uint8_t> data;
+  frame(payload, data);
+  frame(payload, data);
+
+  EXPECT_CALL(mcb, fn(PayloadIs(payload), payload.size())).Times(2);
+
+  d.parse(0, data.data(), data.size());
+
+  ASSERT_EQ(0u, d.stream_stats(0).crc_errors);
+}
+
+TEST(demux, ResyncAfterGarbageAndBadCrc) {
+  mock_stream_callback mcb;
+  demux d{1};
+  d.attach(0, &mcb);
+  std::vector<uint8_t> data = {0x00, 0xA5, 0x11, 0x5A, 0xA5};
+  frame("damaged", data);
+  data[data.size() - 1] ^= 0x01;
+  frame("good", data);
+
+  EXPECT_CALL(mcb, fn(PayloadIs(std::string("good")), 4)).Times(1);
+
+  // split inside the damaged frame, so it is rejected from the staging buffer
+  d.parse(0, data.data(), 9);
+  d.parse(0, data.data() + 9, data.size() - 9);
+
+  ASSERT_EQ(1u, d.stream_stats(0).frames);
+  ASSERT_EQ(1u, d.stream_stats(0).crc_errors);
+  ASSERT_EQ(0u, d.staged(0));
+}
+
+TEST(demux, StreamsAreIndependent) {
+  mock_stream_callback mcb0, mcb1;
+  demux d{2};
+  d.attach(0, &mcb0);
+  d.attach(1, &mcb1);
+  std::vector<uint8_t> a, b;
+  frame("stream zero", a);
+  frame("stream one", b);
+
+  EXPECT_CALL(mcb0, fn(PayloadIs(std::string("stream zero")), 11)).Times(1);
+  EXPECT_CALL(mcb1, fn(PayloadIs(std::string("stream one")), 10)).Times(1);
+
+  d.parse(0, a.data(), 6);
+  d.parse(1, b.data(), 3);
+  d.parse(1, b.data() + 3, b.size() - 3);
+  d.parse(0, a.data() + 6, a.size() - 6);
+
+  ASSERT_EQ(1u, d.stream_stats(0).frames);
+  ASSERT_EQ(1u, d.stream_stats(1).frames);
+}
+
+TEST(demux, ScalarAndSimdAgree) {
+  const bool avx2 = __builtin_cpu_supports("avx2");
+  std::mt19937 rng{42};
+  std::vector<uint8_t> data(256);
+  for (int round = 0; round < 200; ++round) {
+    // a small alphabet so sync words and a lone sync0 at the end show up,
+    // half of the rounds without any sync0 at all
+    const uint8_t alphabet[] = {0x5A, 0x00, 0xFF, 0xA5};
+    const size_t letters = round % 2 ? 4 : 3;
+    for (auto& byte : data) byte = alphabet[rng() % letters];
+    for (size_t offset = 0; offset < 33; ++offset) {
+      for (size_t n = 0; n + offset <= data.size(); n += 7) {
+        const size_t expected = demux::find_scalar(&data[offset], n, 0xA5, 0x5A);
+        ASSERT_EQ(expected, demux::find_sse2(&data[offset], n, 0xA5, 0x5A));
+        if (avx2) {
+          ASSERT_EQ(expected, demux::find_avx2(&data[offset], n, 0xA5, 0x5A));
+        }
+      }
+    }
+  }
+}
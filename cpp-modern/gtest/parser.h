@@ -1,23 +1,68 @@
 #pragma once
 
+#include <array>
+#include <cassert>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
 
 #include "gtest/gtest_prod.h"
-
-class callback;
+#include "callback.h"
 
 #define PACKET_SIZE 32
 
-class parser {
+// Splits a byte stream into fixed size packets. Whole packets are handed to
+// the callback straight from the caller's buffer, as many per call as are
+// contiguous (n is a multiple of the packet size); only a packet that
+// straddles two parse() calls is staged and copied.
+// PacketSize 0 means the size is given to the constructor at run time.
+template <size_t PacketSize>
+class basic_parser {
  public:
-  parser(const callback& cb);
-  void parse(const uint8_t* p, size_t n);
+  explicit basic_parser(const callback& cb, size_t packet_size = PacketSize)
+      : cb_{cb}, packet_size_{packet_size}, temp_buffer_size_{0} {
+    assert(packet_size_ > 0 && (PacketSize == 0 || packet_size_ == PacketSize));
+    if (PacketSize == 0) resize(temp_buffer_, packet_size_);
+  }
+
+  void parse(const uint8_t* ptr, size_t n) {
+    assert(ptr || n == 0);
+    const size_t size = packet_size();
+    if (temp_buffer_size_ > 0) {
+      const size_t need = size - temp_buffer_size_;
+      if (n < need) {
+        std::memcpy(&temp_buffer_[temp_buffer_size_], ptr, n);
+        temp_buffer_size_ += n;
+        return;
+      }
+      std::memcpy(&temp_buffer_[temp_buffer_size_], ptr, need);
+      cb_.fn(&temp_buffer_[0], size);
+      temp_buffer_size_ = 0;
+      ptr += need;
+      n -= need;
+    }
+    const size_t whole = n - n % size;
+    if (whole > 0) cb_.fn(ptr, whole);
+    temp_buffer_size_ = n - whole;
+    if (temp_buffer_size_ > 0) std::memcpy(&temp_buffer_[0], ptr + whole, temp_buffer_size_);
+  }
+
+  size_t packet_size() const { return PacketSize ? PacketSize : packet_size_; }
 
  private:
+  using Storage = typename std::conditional<PacketSize == 0, std::vector<uint8_t>,
+                                            std::array<uint8_t, PacketSize ? PacketSize : 1>>::type;
+
+  static void resize(std::vector<uint8_t>& v, size_t n) { v.resize(n); }
+  template <typename T>
+  static void resize(T&, size_t) {}
+
   const callback& cb_;
+  const size_t packet_size_;
   size_t temp_buffer_size_;
-  uint8_t temp_buffer_[2 * PACKET_SIZE];
+  Storage temp_buffer_;
 
   FRIEND_TEST(parser, OnePacket);
   FRIEND_TEST(parser, TwoPackets);
@@ -26,4 +71,12 @@ class parser {
   FRIEND_TEST(parser, ThreeHalfPackets);
   FRIEND_TEST(parser, OneHalfPacketPlusOneFullPacket);
   FRIEND_TEST(parser, 31_plus_32);
+  FRIEND_TEST(parser, ManyPacketsOneCall);
+  FRIEND_TEST(parser, RuntimePacketSize);
 };
+
+extern template class basic_parser<PACKET_SIZE>;
+extern template class basic_parser<0>;
+
+using parser = basic_parser<PACKET_SIZE>;
+using runtime_parser = basic_parser<0>;
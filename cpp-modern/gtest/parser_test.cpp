@@ -5,6 +5,7 @@
 #include "callback.h"
 
 using ::testing::_;
+using ::testing::InSequence;
 
 MATCHER_P2(ByteBufferMatcher, buffer, length, "") {
   return std::equal(arg, arg + length, buffer);
@@ -141,3 +142,50 @@ TEST(parser, 31_plus_32) {
 
   ASSERT_EQ(31, p1.temp_buffer_size_);
 }
+
+// whole packets come straight from the caller's buffer, batched
+TEST(parser, ManyPacketsOneCall) {
+  mock_callback mcb;
+  parser p1{mcb};
+
+  uint8_t data[16 + 16 + 64 + 8];
+  std::memset(data, 0xFF, sizeof data);
+
+  uint8_t expected[64];
+  std::memset(expected, 0xFF, 64);
+
+  {
+    InSequence s;
+    EXPECT_CALL(mcb, fn(ByteBufferMatcher(expected, 32), 32)).Times(1);
+    EXPECT_CALL(mcb, fn(data + 32, 64)).Times(1);
+  }
+
+  p1.parse(data, 16);
+  p1.parse(data + 16, sizeof data - 16);
+
+  ASSERT_EQ(8, p1.temp_buffer_size_);
+}
+
+TEST(parser, RuntimePacketSize) {
+  mock_callback mcb;
+  runtime_parser p1{mcb, 10};
+  ASSERT_EQ(10u, p1.packet_size());
+
+  uint8_t data[25];
+  for (uint8_t i = 0; i < 25; ++i) data[i] = i;
+
+  uint8_t expected[10] = {20, 21, 22, 23, 24, 5, 6, 7, 8, 9};
+
+  {
+    InSequence s;
+    EXPECT_CALL(mcb, fn(data, 20)).Times(1);
+    EXPECT_CALL(mcb, fn(ByteBufferMatcher(expected, 10), 10)).Times(1);
+  }
+
+  p1.parse(data, 25);
+  ASSERT_EQ(5, p1.temp_buffer_size_);
+  p1.parse(data + 5, 5);  // bytes 5..9 complete the staged 20..24
+  ASSERT_EQ(0, p1.temp_buffer_size_);
+  p1.parse(data, 0);
+  ASSERT_EQ(0, p1.temp_buffer_size_);
+}
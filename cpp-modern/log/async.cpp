@@ -0,0 +1,356 @@
+#include "async.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace log {
+
+namespace {
+
+//byte ring with one producer (the logging thread) and one consumer (the
+//flusher), records are committed whole so the output never has torn lines
+class staging {
+ public:
+  explicit staging(std::size_t capacity) : data_(new char[capacity]), mask_(capacity - 1) { }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  //producer: bytes in use, the cached head is refreshed only when it
+  //would not leave room for `need` more
+  std::size_t used(std::size_t need) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (capacity() - (tail - head_cache_) < need) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+    }
+    return tail - head_cache_;
+  }
+
+  //producer: caller checked there is room
+  void put(const char* data, std::size_t size) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t at = tail & mask_;
+    std::size_t first = std::min(size, capacity() - at);
+    std::memcpy(&data_[at], data, first);
+    std::memcpy(&data_[0], data + first, size - first);
+    tail_.store(tail + size, std::memory_order_release);
+  }
+
+  //consumer: committed bytes as one or two spans, returns how many
+  int spans(iovec* iov) const {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    std::size_t tail = tail_.load(std::memory_order_acquire);
+    std::size_t n = tail - head;
+    if (n == 0) return 0;
+    std::size_t at = head & mask_;
+    std::size_t first = std::min(n, capacity() - at);
+    iov[0].iov_base = &data_[at];
+    iov[0].iov_len = first;
+    if (n == first) return 1;
+    iov[1].iov_base = &data_[0];
+    iov[1].iov_len = n - first;
+    return 2;
+  }
+
+  //consumer
+  void release(std::size_t n) {
+    head_.store(head_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+
+  //consumer
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+  }
+
+  std::atomic<bool> closed{false}; //owning thread has exited
+  std::atomic<std::uint64_t> records{0}; //written by the producer only
+  std::atomic<std::uint64_t> dropped{0}; //written by the producer only
+  unsigned sample_tick = 0;
+
+ private:
+  std::unique_ptr<char[]> data_;
+  const std::size_t mask_;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_ = 0;
+};
+
+void bump(std::atomic<std::uint64_t>& counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+std::size_t round_up(std::size_t n) {
+  std::size_t pow2 = 64;
+  while (pow2 < n) pow2 <<= 1;
+  return pow2;
+}
+
+struct local_slot {
+  std::uint64_t generation = 0;
+  std::shared_ptr<staging> ring;
+  ~local_slot() {
+    if (ring) ring->closed.store(true, std::memory_order_release);
+  }
+};
+
+thread_local local_slot slot_;
+std::uint64_t generations_ = 0;
+
+class backend {
+ public:
+  explicit backend(const async_options& options)
+    : options_(options), capacity_(round_up(options.buffer_size)), generation_(++generations_),
+      flusher_(&backend::run, this) {
+    if (options_.sample_rate == 0) options_.sample_rate = 1;
+  }
+
+  ~backend() { shutdown(); }
+
+  //stops the flusher after it has drained every buffer
+  void shutdown() {
+    if (!flusher_.joinable()) return;
+    stopping_.store(true, std::memory_order_release);
+    wake();
+    {
+      std::lock_guard<std::mutex> lock(space_mutex_);
+      space_cv_.notify_all();
+    }
+    flusher_.join();
+  }
+
+  bool write(const char* data, std::size_t size) {
+    staging* ring = local();
+    const std::size_t cap = ring->capacity();
+    std::size_t used = ring->used(size);
+    if (size > cap) {
+      bump(ring->dropped);
+      return false;
+    }
+    if (options_.policy == overflow::sample && used + size > cap / 2) {
+      if (ring->sample_tick++ % options_.sample_rate != 0) {
+        bump(ring->dropped);
+        return false;
+      }
+    }
+    while (cap - used < size) {
+      if (options_.policy != overflow::block || stopping_.load(std::memory_order_relaxed)) {
+        bump(ring->dropped);
+        return false;
+      }
+      wait_for_space(ring, size);
+      used = ring->used(size);
+    }
+    ring->put(data, size);
+    bump(ring->records);
+    //kick the flusher once per crossing of the half full mark
+    if (used < cap / 2 && used + size >= cap / 2) {
+      wake();
+    }
+    return true;
+  }
+
+  async_counters stats() {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    async_counters c = retired_;
+    for (const auto& ring : registry_) {
+      c.records += ring->records.load(std::memory_order_relaxed);
+      c.dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    c.bytes = bytes_.load(std::memory_order_relaxed);
+    c.errors = errors_.load(std::memory_order_relaxed);
+    return c;
+  }
+
+ private:
+  staging* local() {
+    if (slot_.generation != generation_) {
+      if (slot_.ring) slot_.ring->closed.store(true, std::memory_order_release);
+      slot_.ring = std::make_shared<staging>(capacity_);
+      slot_.generation = generation_;
+      std::lock_guard<std::mutex> lock(registry_mutex_);
+      registry_.push_back(slot_.ring);
+      version_.fetch_add(1, std::memory_order_release);
+    }
+    return slot_.ring.get();
+  }
+
+  //overflow::block: sleeps until the flusher made room for `size` bytes in
+  //`ring`; like the flusher it never waits longer than flush_interval
+  void wait_for_space(staging* ring, std::size_t size) {
+    wake();
+    blocked_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst); //pairs with space_freed()
+    {
+      std::unique_lock<std::mutex> lock(space_mutex_);
+      space_cv_.wait_for(lock, options_.flush_interval, [&] {
+        return ring->capacity() - ring->used(size) >= size || stopping_.load(std::memory_order_acquire);
+      });
+    }
+    blocked_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  //flusher, after releasing bytes: wakes blocked writers, if any
+  void space_freed() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (blocked_.load(std::memory_order_relaxed) == 0) return;
+    std::lock_guard<std::mutex> lock(space_mutex_);
+    space_cv_.notify_all();
+  }
+
+  //a lost notification only costs one flush_interval, the flusher never
+  //waits without a timeout
+  void wake() {
+    urgent_.store(true, std::memory_order_release);
+    cv_.notify_one();
+  }
+
+  void run() {
+    std::vector<std::shared_ptr<staging>> rings;
+    std::uint64_t seen = ~std::uint64_t{0};
+    for (;;) {
+      bool stop = stopping_.load(std::memory_order_acquire);
+      std::uint64_t version = version_.load(std::memory_order_acquire);
+      if (version != seen) {
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        rings = registry_;
+        seen = version;
+      }
+      bool progress = flush(rings);
+      reap(rings);
+      if (!progress) {
+        if (stop) break;
+        std::unique_lock<std::mutex> lock(cv_mutex_);
+        cv_.wait_for(lock, options_.flush_interval, [this] {
+          return urgent_.load(std::memory_order_acquire) || stopping_.load(std::memory_order_acquire);
+        });
+        urgent_.store(false, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  //one writev over every committed span, returns false when there was
+  //nothing to write or the fd is not ready
+  bool flush(const std::vector<std::shared_ptr<staging>>& rings) {
+    iov_.clear();
+    owners_.clear();
+    for (const auto& ring : rings) {
+      if (iov_.size() + 2 > IOV_MAX) break;
+      iovec spans[2];
+      int n = ring->spans(spans);
+      for (int i = 0; i < n; ++i) {
+        iov_.push_back(spans[i]);
+        owners_.push_back(ring.get());
+      }
+    }
+    if (iov_.empty()) return false;
+    ssize_t written = ::writev(options_.fd, iov_.data(), static_cast<int>(iov_.size()));
+    std::size_t left;
+    if (written < 0) {
+      if (errno == EINTR) return true;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+      //unrecoverable, discard what we have so logging threads do not stall
+      errors_.fetch_add(1, std::memory_order_relaxed);
+      left = ~std::size_t{0};
+    } else {
+      bytes_.fetch_add(written, std::memory_order_relaxed);
+      left = static_cast<std::size_t>(written);
+    }
+    for (std::size_t i = 0; i < iov_.size() && left > 0; ++i) {
+      std::size_t n = std::min(left, iov_[i].iov_len);
+      owners_[i]->release(n);
+      left -= n;
+    }
+    space_freed();
+    return true;
+  }
+
+  //forget buffers of threads that exited once they are drained
+  void reap(std::vector<std::shared_ptr<staging>>& rings) {
+    for (auto it = rings.begin(); it != rings.end();) {
+      staging* ring = it->get();
+      if (!ring->closed.load(std::memory_order_acquire) || !ring->empty()) {
+        ++it;
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(registry_mutex_);
+      retired_.records += ring->records.load(std::memory_order_relaxed);
+      retired_.dropped += ring->dropped.load(std::memory_order_relaxed);
+      registry_.erase(std::find(registry_.begin(), registry_.end(), *it));
+      it = rings.erase(it);
+    }
+  }
+
+  async_options options_;
+  const std::size_t capacity_;
+  const std::uint64_t generation_;
+
+  std::mutex registry_mutex_;
+  std::vector<std::shared_ptr<staging>> registry_;
+  async_counters retired_{0, 0, 0, 0};
+  std::atomic<std::uint64_t> version_{0};
+
+  std::mutex cv_mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> urgent_{false};
+  std::atomic<bool> stopping_{false};
+
+  std::mutex space_mutex_;
+  std::condition_variable space_cv_;
+  std::atomic<unsigned> blocked_{0}; //writers in wait_for_space()
+
+  //flusher only
+  std::vector<iovec> iov_;
+  std::vector<staging*> owners_;
+  std::atomic<std::uint64_t> bytes_{0};
+  std::atomic<std::uint64_t> errors_{0};
+
+  std::thread flusher_;
+};
+
+std::atomic<backend*> backend_{nullptr};
+std::mutex backend_mutex_;
+
+}
+
+void start_async(const async_options& options) {
+  std::lock_guard<std::mutex> lock(backend_mutex_);
+  //sync mode writes through std::cout, keep its records first
+  std::cout.flush();
+  delete backend_.exchange(nullptr, std::memory_order_acq_rel);
+  backend_.store(new backend(options), std::memory_order_release);
+}
+
+async_counters stop_async() {
+  std::lock_guard<std::mutex> lock(backend_mutex_);
+  std::unique_ptr<backend> b(backend_.exchange(nullptr, std::memory_order_acq_rel));
+  if (!b) return async_counters{0, 0, 0, 0};
+  b->shutdown();
+  return b->stats();
+}
+
+bool async_enabled() {
+  return backend_.load(std::memory_order_acquire) != nullptr;
+}
+
+bool async_write(const char* data, std::size_t size) {
+  backend* b = backend_.load(std::memory_order_acquire);
+  return b != nullptr && b->write(data, size);
+}
+
+async_counters async_stats() {
+  std::lock_guard<std::mutex> lock(backend_mutex_);
+  backend* b = backend_.load(std::memory_order_relaxed);
+  return b ? b->stats() : async_counters{0, 0, 0, 0};
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <unistd.h>
+
+namespace log {
+
+//what a logging thread does when its staging buffer cannot take a record
+enum class overflow {
+  drop,   //discard the record, never wait
+  block,  //wake the flusher and wait for room
+  sample  //above half full keep one record in sample_rate, drop when full
+};
+
+struct async_options {
+  int fd = STDOUT_FILENO;
+  std::size_t buffer_size = 64 * 1024; //per thread, rounded up to a power of 2
+  overflow policy = overflow::drop;
+  unsigned sample_rate = 16;
+  std::chrono::milliseconds flush_interval{10};
+};
+
+struct async_counters {
+  std::uint64_t records; //accepted into a staging buffer
+  std::uint64_t dropped; //rejected by the overflow policy
+  std::uint64_t bytes;   //handed to writev by the flusher
+  std::uint64_t errors;  //failed writev calls, their bytes are discarded
+};
+
+//Routes finished log records to per-thread lock-free staging buffers that a
+//background thread drains with writev. start_async/stop_async must not race
+//with logging threads; stop_async flushes everything before returning.
+void start_async(const async_options& options = async_options());
+//returns the final counters
+async_counters stop_async();
+bool async_enabled();
+//false when the record was dropped or async mode is off
+bool async_write(const char* data, std::size_t size);
+async_counters async_stats();
+
+}
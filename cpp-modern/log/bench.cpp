@@ -0,0 +1,205 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async.h"
+#include "binary.h"
+#include "log.h"
+
+//throughput, scaling and tail latency of a LOG_I statement when logging is
+//disabled, when its category is filtered out, and when it is written (async
+//backend, block policy) to /dev/null, a file or a pipe
+//usage: ./bench [calls per run]
+
+using clock_type = std::chrono::steady_clock;
+
+enum class condition { disabled, filtered, enabled };
+
+static const char* to_string(condition c) {
+  switch (c) {
+    case condition::disabled: return "disabled";
+    case condition::filtered: return "filtered";
+    case condition::enabled: return "enabled";
+  }
+  return "?";
+}
+
+static void set(condition c) {
+  log::enable(c != condition::disabled);
+  if (c == condition::filtered) {
+    log::block("bench");
+  } else {
+    log::unblock("bench");
+  }
+}
+
+//where enabled records end up
+class sink {
+ public:
+  explicit sink(const std::string& kind) : kind_(kind) {
+    if (kind == "null") {
+      fd_ = ::open("/dev/null", O_WRONLY);
+    } else if (kind == "file") {
+      fd_ = ::open("bench.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    } else {
+      int fds[2];
+      if (::pipe(fds) == 0) {
+        fd_ = fds[1];
+        reader_ = std::thread([fd = fds[0]] {
+          char buf[1 << 16];
+          while (::read(fd, buf, sizeof buf) > 0) { }
+          ::close(fd);
+        });
+      }
+    }
+    if (fd_ < 0) {
+      std::perror(kind.c_str());
+      std::exit(1);
+    }
+  }
+
+  ~sink() {
+    ::close(fd_);
+    if (reader_.joinable()) reader_.join();
+    if (kind_ == "file") ::unlink("bench.log");
+  }
+
+  int fd() const { return fd_; }
+
+ private:
+  std::string kind_;
+  int fd_ = -1;
+  std::thread reader_;
+};
+
+struct result {
+  double ns_per_call; //wall time of the whole run divided by calls
+  double calls_per_s; //all threads together
+  std::vector<std::uint32_t> latencies; //per call, when asked for
+};
+
+//`calls` statements split over `threads`, binary uses LOG_BIN_I instead
+static result run(unsigned threads, long calls, bool latency, bool binary) {
+  result r;
+  const long per_thread = calls / threads;
+  std::vector<std::vector<std::uint32_t>> samples(threads);
+  std::vector<std::thread> pool;
+  std::atomic<unsigned> ready{0};
+  std::atomic<bool> go{false};
+  for (unsigned t = 0; t < threads; ++t) {
+    pool.emplace_back([&, t] {
+      std::vector<std::uint32_t>& mine = samples[t];
+      if (latency) mine.reserve(per_thread);
+      ++ready;
+      while (!go.load()) std::this_thread::yield();
+      for (long i = 0; i < per_thread; ++i) {
+        auto start = latency ? clock_type::now() : clock_type::time_point();
+        if (binary) {
+          LOG_BIN_I("bench", "request {} took {}ms", i, 1.5);
+        } else {
+          LOG_I("bench") << "request " << i << " took " << 1.5 << "ms" << std::endl;
+        }
+        if (latency) {
+          mine.push_back(static_cast<std::uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count()));
+        }
+      }
+    });
+  }
+  while (ready.load() != threads) std::this_thread::yield();
+  auto start = clock_type::now();
+  go.store(true);
+  for (auto& t : pool) t.join();
+  double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  r.ns_per_call = seconds * 1e9 / (per_thread * threads);
+  r.calls_per_s = per_thread * threads / seconds;
+  for (auto& s : samples) r.latencies.insert(r.latencies.end(), s.begin(), s.end());
+  std::sort(r.latencies.begin(), r.latencies.end());
+  return r;
+}
+
+static double percentile(const std::vector<std::uint32_t>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+}
+
+static log::async_options options(int fd) {
+  log::async_options o;
+  o.fd = fd;
+  o.policy = log::overflow::block;
+  o.buffer_size = 1 << 20;
+  return o;
+}
+
+//the clock reads of the latency runs are part of every percentile
+static double clock_overhead() {
+  const int n = 1000000;
+  auto start = clock_type::now();
+  for (int i = 0; i < n; ++i) {
+    auto t = clock_type::now();
+    asm volatile("" : : "r"(&t) : "memory");
+  }
+  return std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+  const long calls = argc > 1 ? std::atol(argv[1]) : 200000;
+  log::add("bench");
+  log::set_level(log::level::info);
+
+  std::printf("clock read: %.1f ns\n\n", clock_overhead());
+
+  std::printf("single thread, %ld calls\n", calls);
+  std::printf("%-6s %-9s %-6s %10s %8s %8s %8s\n", "sink", "condition", "format", "ns/call", "p50", "p99", "p999");
+  for (const char* kind : { "null", "file", "pipe" }) {
+    for (condition c : { condition::disabled, condition::filtered, condition::enabled }) {
+      for (bool binary : { false, true }) {
+        if (binary && std::string(kind) != "file") continue; //binary mode opens its own file
+        sink s(kind);
+        set(c);
+        if (binary) {
+          if (!log::start_binary("bench.bin", options(-1))) {
+            std::perror("bench.bin");
+            std::exit(1);
+          }
+        } else {
+          log::start_async(options(s.fd()));
+        }
+        run(1, calls / 10, false, binary); //warm up buffers and call sites
+        double ns = run(1, calls, false, binary).ns_per_call;
+        result r = run(1, calls, true, binary);
+        if (binary) {
+          log::stop_binary();
+          ::unlink("bench.bin");
+        } else {
+          log::stop_async();
+        }
+        std::printf("%-6s %-9s %-6s %10.1f %8.0f %8.0f %8.0f\n", kind, to_string(c), binary ? "binary" : "text",
+                    ns, percentile(r.latencies, 0.5), percentile(r.latencies, 0.99), percentile(r.latencies, 0.999));
+      }
+    }
+  }
+
+  std::printf("\nthreads, %ld calls in total, null sink\n", calls);
+  std::printf("%-7s %-9s %12s %8s %8s %8s\n", "threads", "condition", "Mcalls/s", "p50", "p99", "p999");
+  for (condition c : { condition::filtered, condition::enabled }) {
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+      sink s("null");
+      set(c);
+      log::start_async(options(s.fd()));
+      result r = run(threads, calls, true, false);
+      log::stop_async();
+      std::printf("%-7u %-9s %12.2f %8.0f %8.0f %8.0f\n", threads, to_string(c), r.calls_per_s / 1e6,
+                  percentile(r.latencies, 0.5), percentile(r.latencies, 0.99), percentile(r.latencies, 0.999));
+    }
+  }
+  return 0;
+}
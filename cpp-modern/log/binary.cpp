@@ -0,0 +1,279 @@
+#include "binary.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace log {
+
+namespace {
+
+const char magic[8] = { 'X', 'L', 'O', 'G', 'B', 'I', 'N', '1' };
+
+struct descriptor {
+  level lvl;
+  int line;
+  std::string category;
+  std::string file;
+  std::string format;
+  std::string codes;
+};
+
+std::vector<descriptor> sites_; //id - 1
+std::mutex sites_mutex_;
+std::atomic<bool> binary_{false};
+std::atomic<bool> failed_{false}; //a descriptor could not be written
+int fd_ = -1;
+
+std::int64_t now(clockid_t clock) {
+  timespec ts;
+  ::clock_gettime(clock, &ts);
+  return std::int64_t{ts.tv_sec} * 1000000000 + ts.tv_nsec;
+}
+
+void append(std::string& out, const void* p, std::size_t n) {
+  out.append(static_cast<const char*>(p), n);
+}
+
+//the whole buffer or false, retries short writes and EINTR
+bool write_all(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t n = ::write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+//called with sites_mutex_ held, straight to the fd (O_APPEND) so it lands
+//before any record that uses it; false when it could not be written
+bool write_descriptor(std::uint32_t id) {
+  const descriptor& d = sites_[id - 1];
+  std::string record(binary::header_size, '\0');
+  std::uint32_t fields[3] = { id, static_cast<std::uint32_t>(d.lvl), static_cast<std::uint32_t>(d.line) };
+  append(record, fields, sizeof fields);
+  for (const std::string* s : { &d.category, &d.file, &d.format, &d.codes }) {
+    record.append(s->c_str(), s->size() + 1);
+  }
+  binary::put_header(&record[0], static_cast<std::uint32_t>(record.size()), binary::descriptor_site);
+  return write_all(fd_, record.data(), record.size());
+}
+
+template <typename T> bool get(const char*& p, const char* end, T& v) {
+  if (end - p < static_cast<std::ptrdiff_t>(sizeof v)) return false;
+  std::memcpy(&v, p, sizeof v);
+  p += sizeof v;
+  return true;
+}
+
+//renders one argument, false when the payload is short
+bool render(char code, const char*& p, const char* end, std::string& out) {
+  switch (code) {
+    case 'b': { char v; if (!get(p, end, v)) return false; out += v ? "true" : "false"; return true; }
+    case 'c': { char v; if (!get(p, end, v)) return false; out += v; return true; }
+    case 'i': { std::int32_t v; if (!get(p, end, v)) return false; out += std::to_string(v); return true; }
+    case 'I': { std::uint32_t v; if (!get(p, end, v)) return false; out += std::to_string(v); return true; }
+    case 'l': { std::int64_t v; if (!get(p, end, v)) return false; out += std::to_string(v); return true; }
+    case 'L': { std::uint64_t v; if (!get(p, end, v)) return false; out += std::to_string(v); return true; }
+    case 'd': {
+      double v;
+      if (!get(p, end, v)) return false;
+      char buf[32];
+      std::snprintf(buf, sizeof buf, "%g", v);
+      out += buf;
+      return true;
+    }
+    case 'p': {
+      std::uint64_t v;
+      if (!get(p, end, v)) return false;
+      char buf[24];
+      std::snprintf(buf, sizeof buf, "0x%llx", static_cast<unsigned long long>(v));
+      out += buf;
+      return true;
+    }
+    case 's': {
+      std::uint32_t n;
+      if (!get(p, end, n) || end - p < static_cast<std::ptrdiff_t>(n)) return false;
+      out.append(p, n);
+      p += n;
+      return true;
+    }
+  }
+  return false;
+}
+
+//"{}" takes the next argument, arguments left over are appended
+std::string format(const descriptor& d, const char* p, const char* end) {
+  std::string out;
+  std::size_t arg = 0;
+  const std::string& f = d.format;
+  for (std::size_t i = 0; i < f.size(); ++i) {
+    if (f[i] == '{' && i + 1 < f.size() && f[i + 1] == '}' && arg < d.codes.size()) {
+      if (!render(d.codes[arg++], p, end, out)) return out + "<truncated>";
+      ++i;
+    } else {
+      out += f[i];
+    }
+  }
+  while (arg < d.codes.size()) {
+    out += ' ';
+    if (!render(d.codes[arg++], p, end, out)) return out + "<truncated>";
+  }
+  return out;
+}
+
+struct entry {
+  std::uint64_t time;
+  std::uint64_t thread;
+  std::uint32_t site;
+  const char* payload;
+  const char* end;
+};
+
+}
+
+namespace binary {
+
+char* put_header(char* p, std::uint32_t size, std::uint32_t site) {
+  static thread_local const std::uint64_t thread = static_cast<std::uint64_t>(::pthread_self());
+  std::uint64_t time = static_cast<std::uint64_t>(now(CLOCK_MONOTONIC));
+  std::memcpy(p, &size, 4);
+  std::memcpy(p + 4, &site, 4);
+  std::memcpy(p + 8, &time, 8);
+  std::memcpy(p + 16, &thread, 8);
+  return p + header_size;
+}
+
+std::uint32_t register_site(call_site& site, const char* codes) {
+  std::lock_guard<std::mutex> lock(sites_mutex_);
+  std::uint32_t id = site.id.load(std::memory_order_relaxed);
+  if (id != 0) return id;
+  sites_.push_back(descriptor{ site.lvl, site.line, site.category, site.file, site.format, codes });
+  id = static_cast<std::uint32_t>(sites_.size());
+  if (binary_.load(std::memory_order_relaxed) && !write_descriptor(id)) {
+    //its records would be undecodable, stop writing any
+    failed_.store(true, std::memory_order_relaxed);
+  }
+  site.id.store(id, std::memory_order_release);
+  return id;
+}
+
+void write_text(const char* data, std::size_t size) {
+  std::string record(header_size + size, '\0');
+  put_header(&record[0], static_cast<std::uint32_t>(record.size()), text_site);
+  std::memcpy(&record[header_size], data, size);
+  async_write(record.data(), record.size());
+}
+
+}
+
+bool start_binary(const char* path, async_options options) {
+  stop_binary();
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  std::lock_guard<std::mutex> lock(sites_mutex_);
+  std::int64_t offset = now(CLOCK_REALTIME) - now(CLOCK_MONOTONIC);
+  std::string preamble(magic, sizeof magic);
+  append(preamble, &offset, sizeof offset);
+  bool ok = write_all(fd, preamble.data(), preamble.size());
+  fd_ = fd;
+  for (std::uint32_t id = 1; ok && id <= sites_.size(); ++id) ok = write_descriptor(id);
+  if (!ok) {
+    ::close(fd);
+    fd_ = -1;
+    return false;
+  }
+  failed_.store(false, std::memory_order_relaxed);
+  options.fd = fd;
+  start_async(options);
+  binary_.store(true, std::memory_order_release);
+  return true;
+}
+
+async_counters stop_binary() {
+  std::lock_guard<std::mutex> lock(sites_mutex_);
+  if (!binary_.exchange(false, std::memory_order_acq_rel)) return async_counters{0, 0, 0, 0};
+  async_counters c = stop_async();
+  if (failed_.load(std::memory_order_relaxed)) ++c.errors;
+  ::close(fd_);
+  fd_ = -1;
+  return c;
+}
+
+bool binary_enabled() {
+  return binary_.load(std::memory_order_relaxed) && !failed_.load(std::memory_order_relaxed);
+}
+
+bool decode(std::istream& in, std::ostream& out) {
+  std::string file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  const char* p = file.data();
+  const char* end = p + file.size();
+  std::int64_t offset = 0;
+  if (file.size() < sizeof magic + sizeof offset || !std::equal(magic, magic + sizeof magic, p)) return false;
+  p += sizeof magic;
+  get(p, end, offset);
+
+  std::map<std::uint32_t, descriptor> sites;
+  std::vector<entry> entries;
+  while (end - p >= static_cast<std::ptrdiff_t>(binary::header_size)) {
+    entry e;
+    std::uint32_t size;
+    std::memcpy(&size, p, 4);
+    std::memcpy(&e.site, p + 4, 4);
+    std::memcpy(&e.time, p + 8, 8);
+    std::memcpy(&e.thread, p + 16, 8);
+    if (size < binary::header_size || size > static_cast<std::size_t>(end - p)) break;
+    e.payload = p + binary::header_size;
+    e.end = p + size;
+    p += size;
+    if (e.site != binary::descriptor_site) {
+      entries.push_back(e);
+      continue;
+    }
+    std::uint32_t fields[3];
+    const char* q = e.payload;
+    if (!get(q, e.end, fields)) continue;
+    descriptor d{ static_cast<level>(fields[1]), static_cast<int>(fields[2]), {}, {}, {}, {} };
+    for (std::string* s : { &d.category, &d.file, &d.format, &d.codes }) {
+      const char* nul = std::find(q, e.end, '\0');
+      s->assign(q, nul);
+      q = nul == e.end ? nul : nul + 1;
+    }
+    sites[fields[0]] = d;
+  }
+
+  //each thread's records are in order, threads were flushed in batches
+  std::stable_sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) { return a.time < b.time; });
+  for (const entry& e : entries) {
+    if (e.site == binary::text_site) {
+      out.write(e.payload, e.end - e.payload);
+      continue;
+    }
+    auto it = sites.find(e.site);
+    if (it == sites.end()) {
+      out << "<unknown call site " << e.site << ">\n";
+      continue;
+    }
+    const descriptor& d = it->second;
+    out << header(d.lvl, d.category.c_str()) << to_time(static_cast<std::int64_t>(e.time) + offset)
+        << " [" << e.thread << "] " << d.file << ":" << d.line << " - " << format(d, e.payload, e.end) << "\n";
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "async.h"
+#include "log.h"
+
+//Binary log: every LOG_BIN call site owns a constant-initialized call_site
+//with its level, category, location and "{}" format. The first call
+//registers it and gets an id; from then on a call only stores
+//[header][raw argument bytes] through the async backend. The decode tool
+//renders the file offline in the same layout as the text log.
+//
+//file:    "XLOGBIN1" i64 (realtime - monotonic ns), then records
+//record:  u32 size, u32 site, u64 monotonic ns, u64 thread, payload
+//site 0 is a preformatted text record (LOG_* statements in binary mode),
+//site ~0 describes a call site: u32 id, u32 level, u32 line, then
+//category, file, format and argument codes as NUL terminated strings.
+
+namespace log {
+
+struct call_site {
+  constexpr call_site(level lvl, const char* category, const char* file, int line, const char* format)
+    : lvl(lvl), category(category), file(file), line(line), format(format), id(0) { }
+  const level lvl;
+  const char* const category;
+  const char* const file;
+  const int line;
+  const char* const format;
+  std::atomic<std::uint32_t> id;
+};
+
+//opens `path` and routes LOG_BIN and LOG_* records to it through the async
+//backend, started with `options` (its fd is replaced)
+bool start_binary(const char* path, async_options options = async_options());
+//errors also counts a call site descriptor that could not be written,
+//binary_enabled() is false from then on
+async_counters stop_binary();
+bool binary_enabled();
+
+//renders a binary log, false when `in` is not one
+bool decode(std::istream& in, std::ostream& out);
+
+namespace binary {
+
+const std::uint32_t text_site = 0;
+const std::uint32_t descriptor_site = ~std::uint32_t{0};
+const std::size_t header_size = 24;
+
+std::uint32_t register_site(call_site& site, const char* codes);
+void write_text(const char* data, std::size_t size);
+char* put_header(char* p, std::uint32_t size, std::uint32_t site);
+
+//one character per argument, the decoder reads the bytes back with it
+template <typename T> constexpr char code() {
+  using U = std::decay_t<T>;
+  if constexpr (std::is_same<U, bool>::value) return 'b';
+  else if constexpr (std::is_same<U, char>::value) return 'c';
+  else if constexpr (std::is_integral<U>::value && std::is_signed<U>::value) return sizeof(U) <= 4 ? 'i' : 'l';
+  else if constexpr (std::is_integral<U>::value) return sizeof(U) <= 4 ? 'I' : 'L';
+  else if constexpr (std::is_enum<U>::value) return code<std::underlying_type_t<U>>();
+  else if constexpr (std::is_floating_point<U>::value) return 'd';
+  else if constexpr (std::is_convertible<const U&, std::string_view>::value) return 's';
+  else if constexpr (std::is_pointer<U>::value) return 'p';
+  else static_assert(sizeof(U) == 0, "no binary encoding for this argument type");
+}
+
+template <typename... Args> struct codes {
+  static constexpr char value[] = { code<Args>()..., '\0' };
+};
+
+template <typename T> std::size_t encoded_size(const T& v) {
+  constexpr char c = code<T>();
+  if constexpr (c == 's') return 4 + std::string_view(v).size();
+  else if constexpr (c == 'b' || c == 'c') return 1;
+  else if constexpr (c == 'i' || c == 'I') return 4;
+  else return 8;
+}
+
+template <typename T> void encode(char*& p, const T& v) {
+  constexpr char c = code<T>();
+  if constexpr (c == 's') {
+    std::string_view s(v);
+    std::uint32_t n = static_cast<std::uint32_t>(s.size());
+    std::memcpy(p, &n, 4);
+    std::memcpy(p + 4, s.data(), n);
+    p += 4 + n;
+  } else {
+    using U = std::conditional_t<c == 'b' || c == 'c', char,
+              std::conditional_t<c == 'i', std::int32_t,
+              std::conditional_t<c == 'I', std::uint32_t,
+              std::conditional_t<c == 'l', std::int64_t,
+              std::conditional_t<c == 'd', double, std::uint64_t>>>>>;
+    U u;
+    if constexpr (c == 'p') u = reinterpret_cast<std::uintptr_t>(v);
+    else u = static_cast<U>(v);
+    std::memcpy(p, &u, sizeof u);
+    p += sizeof u;
+  }
+}
+
+template <typename... Args> void write(call_site& site, const Args&... args) {
+  std::uint32_t id = site.id.load(std::memory_order_acquire);
+  if (id == 0) id = register_site(site, codes<Args...>::value);
+  const std::size_t size = header_size + (encoded_size(args) + ... + 0);
+  char stack[256];
+  std::unique_ptr<char[]> heap;
+  char* record = stack;
+  if (size > sizeof stack) {
+    heap.reset(new char[size]);
+    record = heap.get();
+  }
+  [[maybe_unused]] char* p = put_header(record, static_cast<std::uint32_t>(size), id);
+  (encode(p, args), ...);
+  async_write(record, size);
+}
+
+}
+
+}
+
+//the descriptor of a call site is written once, so its category has to be
+//a string literal; a log::category parameter could name another category
+//on the next call
+#define LOG_BIN(level, category, ...) \
+do { \
+  static_assert(::log::detail::is_site_constant<decltype(category)>, \
+                "LOG_BIN needs a string literal category"); \
+  static ::log::call_site log_site_{level, ::log::name_of(category), __FILE__, __LINE__, LOG_BIN_FORMAT_(__VA_ARGS__, )}; \
+  if (LOG_ENABLE && ::log::binary_enabled() && ::log::should_log(LOG_INDEX_(category), level)) \
+    LOG_BIN_WRITE_(log_site_, __VA_ARGS__); \
+} while (0)
+
+#define LOG_BIN_FORMAT_(format, ...) format
+#define LOG_BIN_WRITE_(site, format, ...) ::log::binary::write(site, ##__VA_ARGS__)
+
+#define LOG_BIN_D(category, ...) LOG_BIN(::log::level::debug, category, __VA_ARGS__)
+#define LOG_BIN_I(category, ...) LOG_BIN(::log::level::info, category, __VA_ARGS__)
+#define LOG_BIN_W(category, ...) LOG_BIN(::log::level::warning, category, __VA_ARGS__)
+#define LOG_BIN_E(category, ...) LOG_BIN(::log::level::error, category, __VA_ARGS__)
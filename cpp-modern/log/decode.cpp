@@ -0,0 +1,21 @@
+#include <fstream>
+#include <iostream>
+#include "binary.h"
+
+//renders a file written in binary mode (log::start_binary)
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " <file>" << std::endl;
+    return 1;
+  }
+  std::ifstream in(argv[1], std::ios::binary);
+  if (!in) {
+    std::cerr << "cannot open " << argv[1] << std::endl;
+    return 1;
+  }
+  if (!log::decode(in, std::cout)) {
+    std::cerr << argv[1] << " is not a binary log" << std::endl;
+    return 1;
+  }
+  return 0;
+}
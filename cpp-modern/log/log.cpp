@@ -1,4 +1,6 @@
 #include "log.h"
+#include "async.h"
+#include "binary.h"
 
 #include <cstdio>
 #include <ctime>
@@ -7,18 +9,31 @@
 #include <iomanip>
 #include <iostream>
 #include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <vector>
 
 namespace log {
 
-static bool enabled_ = LOG_ENABLE;
-static std::mutex enabled_mutex_;
+//name <-> index registry, only touched when a category is resolved or
+//listed; the enable state lives in detail::unblocked. Built on first use,
+//so log::category objects at namespace scope in other files can resolve
+//themselves during static initialization.
+struct category_entry {
+  std::string name;
+  bool listed;
+};
 
-static level level_ = static_cast<level>(LOG_LEVEL);
-static std::mutex level_mutex_;
+struct registry {
+  std::map<std::string, unsigned> indices;
+  std::vector<category_entry> entries;
+  std::mutex mutex;
+};
 
-static std::map<std::string, bool> ls_;
-static std::mutex ls_mutex_;
+static registry& categories() {
+  static registry r;
+  return r;
+}
 
 //light bg colors
 static const char* red     = "\e[101m\e[97m"; //white on red
@@ -27,59 +42,109 @@ static const char* green   = "\e[102m\e[30m"; //black on green
 static const char* blue    = "\e[104m\e[97m"; //white on blue
 static const char* reset_terminal_attributes = "\e[0m";
 
-bool add(const char* category) {
-  std::lock_guard<std::mutex> lock(ls_mutex_);
-  return ls_.insert(std::make_pair(category, false)).second;
+static std::uint64_t bit(unsigned index) {
+  return std::uint64_t{1} << (index % 64);
 }
 
-void block(const char* category) {
-  std::lock_guard<std::mutex> lock(ls_mutex_);
+static void set_blocked(unsigned index, bool value) {
+  if (value) {
+    detail::unblocked[index / 64].fetch_and(~bit(index), std::memory_order_relaxed);
+  } else {
+    detail::unblocked[index / 64].fetch_or(bit(index), std::memory_order_relaxed);
+  }
+}
+
+//called with the registry mutex held
+static unsigned lookup(const char* category) {
+  registry& r = categories();
+  auto it = r.indices.find(category);
+  if (it != r.indices.end()) {
+    r.entries[it->second].listed = true;
+    return it->second;
+  }
+  if (r.entries.size() == max_categories) {
+    throw std::length_error("log: too many categories");
+  }
+  unsigned index = static_cast<unsigned>(r.entries.size());
+  r.indices.emplace(category, index);
+  r.entries.push_back(category_entry{category, true});
+  set_blocked(index, true);
+  return index;
+}
+
+//"*" means every listed category
+static void set_blocked(const char* category, bool value) {
+  registry& r = categories();
+  std::lock_guard<std::mutex> lock(r.mutex);
   if (category == std::string{"*"}) {
-    //special case where category is "*"
-    for (auto& x : ls_) x.second = false;
+    for (unsigned i = 0; i < r.entries.size(); ++i) {
+      if (r.entries[i].listed) set_blocked(i, value);
+    }
   } else {
-    ls_.at(category) = false;
+    set_blocked(lookup(category), value);
   }
 }
 
-bool blocked(const char* category) {
-  std::lock_guard<std::mutex> lock(ls_mutex_);
-  return !ls_.at(category);
+category::category(const char* name) : index_(index_of(name)), name_(name) { }
+
+unsigned index_of(const char* category) {
+  registry& r = categories();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  return lookup(category);
+}
+
+bool add(const char* category) {
+  registry& r = categories();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto it = r.indices.find(category);
+  if (it != r.indices.end() && r.entries[it->second].listed) return false;
+  lookup(category);
+  return true;
+}
+
+void block(const char* category) {
+  set_blocked(category, true);
 }
 
-bool enabled() {
-  std::lock_guard<std::mutex> lock(enabled_mutex_);
-  return enabled_;
+void unblock(const char* category) {
+  set_blocked(category, false);
+}
+
+bool blocked(const char* category) {
+  registry& r = categories();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto it = r.indices.find(category);
+  return it == r.indices.end() || blocked(it->second);
 }
 
 std::map<std::string, bool> ls() {
-  std::lock_guard<std::mutex> lock(ls_mutex_);
-  return ls_;
+  registry& r = categories();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::map<std::string, bool> result;
+  for (unsigned i = 0; i < r.entries.size(); ++i) {
+    if (r.entries[i].listed) result.emplace(r.entries[i].name, !blocked(i));
+  }
+  return result;
 }
 
+//indices stay valid, call sites may have cached them
 void reset() {
-  {
-    std::lock_guard<std::mutex> lock(enabled_mutex_);
-    enabled_ = LOG_ENABLE;
-  }
-  {
-    std::lock_guard<std::mutex> lock(level_mutex_);
-    level_ = static_cast<level>(LOG_LEVEL);
-  }
-  {
-    std::lock_guard<std::mutex> lock(ls_mutex_);
-    ls_.clear();
+  detail::enabled.store(LOG_ENABLE, std::memory_order_relaxed);
+  detail::threshold.store(static_cast<level>(LOG_LEVEL), std::memory_order_relaxed);
+  registry& r = categories();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for (unsigned i = 0; i < r.entries.size(); ++i) {
+    r.entries[i].listed = false;
+    set_blocked(i, true);
   }
 }
 
 void enable(bool value) {
-  std::lock_guard<std::mutex> lock(enabled_mutex_);
-  enabled_ = value;
+  detail::enabled.store(value, std::memory_order_relaxed);
 }
 
 void set_level(level value) {
-  std::lock_guard<std::mutex> lock(level_mutex_);
-  level_ = value;
+  detail::threshold.store(value, std::memory_order_relaxed);
 }
 
 std::string to_color(level lvl) {
@@ -96,56 +161,50 @@ std::string to_string(level lvl) {
   return level_names[i];
 }
 
-void unblock(const char* category) {
-  std::lock_guard<std::mutex> lock(ls_mutex_);
-  if (category == std::string{"*"}) {
-    //special case where category is "*"
-    for (auto& x : ls_) x.second = true;
+log::~log() {
+  const std::string record = os_.str();
+  if (binary_enabled()) {
+    binary::write_text(record.data(), record.size());
+  } else if (async_enabled()) {
+    async_write(record.data(), record.size());
   } else {
-    ls_.at(category) = true;
+    std::cout << record;
   }
 }
 
-bool can_log(level lvl) {
-  return lvl <= level_;
+std::ostringstream& log::stream(level lvl, const char* category) {
+  os_ << header(lvl, category);
+  os_.clear(); //reset error flags
+  return os_;
 }
 
-log::~log() {
-  std::cout << os_.str();
+std::string header(level lvl, const char* category) {
+  return to_color(lvl) + " " + to_string(lvl) + " " + reset_terminal_attributes + " [" + category + "] ";
 }
 
-std::ostringstream& log::stream(level lvl, const char* category) {
-  os_ << to_color(lvl) << " " << to_string(lvl) << " " << reset_terminal_attributes << " [" << category << "] ";
-  os_.clear(); //reset error flags
-  return os_;
+std::string to_time(std::int64_t ns_since_epoch) {
+  std::time_t t = static_cast<std::time_t>(ns_since_epoch / 1000000000);
+  std::tm tm;
+  localtime_r(&t, &tm);
+  char str[32];
+  int ms = static_cast<int>(ns_since_epoch / 1000000 % 1000);
+  std::snprintf(str, sizeof str, "%02d:%02d:%02d.%03d", tm.tm_hour, tm.tm_min, tm.tm_sec, ms);
+  return str;
 }
 
-//TODO
 std::string current_time() {
-//  std::time_t t = std::time(nullptr);
-//  std::tm* tm = std::localtime(&t);
-//  static auto start = std::chrono::high_resolution_clock::now();
-//  auto now = std::chrono::high_resolution_clock::now();
-//  auto ellapsed = std::chrono::duration<double, std::milli>(now - start).count();
-//  std::time_t now_c = std::chrono::system_clock::to_time_t(ellapsed);
-//  std::cout << "* *" << ellapsed << "* *"; 
-//  auto x =std::chrono::steady_clock::now();
-//  static auto start = std::chrono::steady_clock::now();
-//  auto now = std::chrono::steady_clock::now();
-  char str[] = "00:00:00.000";
-  int h = 0;
-  int m = 0;
-  int s = 0;
-  int ms = 0;
-  std::sprintf(str, "%02d:%02d:%02d.%03d", h, m, s, ms);
-  return str;
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  return to_time(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
 }
 
+//formatted once per thread
 std::string current_thread() {
-  std::string id{"?"};
-  std::stringstream ss;
-  ss << std::this_thread::get_id();
-  return ss.str();
+  static thread_local const std::string id = [] {
+    std::ostringstream ss;
+    ss << std::this_thread::get_id();
+    return ss.str();
+  }();
+  return id;
 }
 
 }
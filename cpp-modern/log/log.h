@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <sstream>
 #include <string>
+#include <type_traits>
 
 //compile with -DNLOG to disable LOG completely
 #if defined(NLOG)
@@ -22,6 +25,28 @@ namespace log {
 
 enum class level { error, warning, info, debug };
 
+const unsigned max_categories = 256;
+
+//a category resolved up front, e.g. const log::category net{"net"}; in a
+//function or class scope (the registry is built on first use, so namespace
+//scope works too). LOG_*(net) then skips even the per call site lookup
+class category {
+ public:
+  explicit category(const char* name);
+  unsigned index() const { return index_; }
+  const char* name() const { return name_; }
+ private:
+  unsigned index_;
+  const char* name_;
+};
+
+namespace detail {
+//read with relaxed loads on every log statement, written by the setters
+inline std::atomic<bool> enabled{LOG_ENABLE};
+inline std::atomic<level> threshold{static_cast<level>(LOG_LEVEL)};
+inline std::atomic<std::uint64_t> unblocked[max_categories / 64];
+}
+
 class log {
   log(const log&) = delete;
   log& operator=(const log&) = delete;
@@ -38,26 +63,84 @@ void block(const char* category);
 void unblock(const char* category);
 bool blocked(const char* category);
 void enable(bool);
-bool enabled();
 std::map<std::string, bool> ls();
 void reset();
 void set_level(level lvl);
-bool can_log(level lvl);
+//index of a category, unknown ones are added (blocked); throws
+//std::length_error past max_categories
+unsigned index_of(const char* category);
+
+inline unsigned index_of(const category& c) { return c.index(); }
+
+constexpr const char* name_of(const char* category) { return category; }
+
+inline const char* name_of(const category& c) { return c.name(); }
+
+inline unsigned index_of(const std::string& category) { return index_of(category.c_str()); }
+
+inline const char* name_of(const std::string& category) { return category.c_str(); }
+
+namespace detail {
+//what a call site may resolve once and cache: a string literal (or any
+//other const char array). A category handle is not, a const category&
+//parameter can be a different one on every call, but index_of() of a
+//handle is a member read anyway; a const char* or a std::string is
+//looked up on every call
+template <class T>
+constexpr bool is_site_constant =
+  std::is_array_v<std::remove_reference_t<T>> &&
+  std::is_const_v<std::remove_extent_t<std::remove_reference_t<T>>>;
+}
+
+inline bool enabled() {
+  return detail::enabled.load(std::memory_order_relaxed);
+}
+
+inline bool can_log(level lvl) {
+  return lvl <= detail::threshold.load(std::memory_order_relaxed);
+}
+
+inline bool blocked(unsigned index) {
+  return !(detail::unblocked[index / 64].load(std::memory_order_relaxed) >> (index % 64) & 1);
+}
+
+//what a log statement checks, no locks and no lookups
+inline bool should_log(unsigned index, level lvl) {
+  return enabled() && can_log(lvl) && !blocked(index);
+}
+
 std::string to_color(level lvl);
 std::string to_string(level lvl);
+//"<color> L <reset> [category] ", what every record starts with
+std::string header(level lvl, const char* category);
+//local wall clock time as HH:MM:SS.mmm
+std::string to_time(std::int64_t ns_since_epoch);
 std::string current_time();
 std::string current_thread();
 
 }
 
+//a literal category is looked up once per call site, on its first execution;
+//a handle or a runtime string is resolved on every call
+#define LOG_INDEX_(category) \
+  [&](auto site_constant) { \
+    if constexpr (decltype(site_constant)::value) { \
+      static const unsigned log_index_ = ::log::index_of(category); \
+      return log_index_; \
+    } else { \
+      return ::log::index_of(category); \
+    } \
+  }(std::bool_constant<::log::detail::is_site_constant<decltype(category)>>{})
+
+
 #define LOG_BASIC(level, category) \
 if (LOG_ENABLE) \
-  if (log::enabled() && !log::blocked(category) &&log::can_log(level)) \
-    log::log().stream(level, category)
+  if (::log::should_log(LOG_INDEX_(category), level)) \
+    ::log::log().stream(level, ::log::name_of(category))
 
-#define LOG_(level, category) LOG_BASIC(level, category) << log::current_time() << " [" << log::current_thread() << "] " << __FILE__ << ":" << __LINE__ << " - "
+#define LOG_(level, category) LOG_BASIC(level, category) << ::log::current_time() << " [" << ::log::current_thread() << "] " << __FILE__ << ":" << __LINE__ << " - "
 
-#define LOG_D(category) LOG_(log::level::debug, category)
-#define LOG_I(category) LOG_(log::level::info, category)
-#define LOG_W(category) LOG_(log::level::warning, category)
-#define LOG_E(category) LOG_(log::level::error, category)
+#define LOG_D(category) LOG_(::log::level::debug, category)
+#define LOG_I(category) LOG_(::log::level::info, category)
+#define LOG_W(category) LOG_(::log::level::warning, category)
+#define LOG_E(category) LOG_(::log::level::error, category)
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "log.h"
+#include "async.h"
 
 int main() {
   const char* c1 = "category1";
@@ -26,4 +27,9 @@ int main() {
   log::set_level(log::level::warning);
   LOG_I(c1) << "should not display" << std::endl;
 
+  //same statements, written by the background flusher
+  log::start_async();
+  LOG_W(c1) << "message 5 (async)" << std::endl;
+  LOG_E(c3) << "message 6 (async)" << std::endl;
+  log::stop_async();
 }
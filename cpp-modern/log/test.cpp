@@ -1,5 +1,16 @@
 #include <gtest/gtest.h>
 #include "log.h"
+#include "async.h"
+#include "binary.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace log {
 
@@ -97,5 +108,280 @@ TEST_F(LogTest, output_to_disabled_level) {
 }
 
 
+
+TEST_F(LogTest, unknown_category) {
+  EXPECT_NO_THROW(EXPECT_TRUE(blocked("nobody")));
+  EXPECT_NO_THROW(unblock("late"));
+  EXPECT_FALSE(blocked("late"));
+  EXPECT_EQ(1u, ls().size());
+  EXPECT_FALSE(add("late"));
+}
+
+TEST_F(LogTest, index_and_handle) {
+  unsigned i = index_of("cat1");
+  EXPECT_EQ(i, index_of("cat1"));
+  EXPECT_NE(i, index_of("cat2"));
+  category cat1{"cat1"};
+  EXPECT_EQ(i, cat1.index());
+  EXPECT_TRUE(blocked(i));
+  unblock("cat1");
+  EXPECT_FALSE(blocked(i));
+  EXPECT_TRUE(should_log(i, level::info));
+  set_level(level::warning);
+  EXPECT_FALSE(should_log(i, level::info));
+  EXPECT_TRUE(should_log(i, level::error));
+  enable(false);
+  EXPECT_FALSE(should_log(i, level::error));
+  reset();
+  EXPECT_TRUE(ls().empty());
+  EXPECT_TRUE(blocked(i));
+  EXPECT_EQ(i, index_of("cat1")); //cached indices survive reset
+}
+
+TEST_F(LogTest, toggle_while_logging) {
+  async_options o;
+  o.fd = ::open("/dev/null", O_WRONLY);
+  start_async(o);
+  std::atomic<bool> done{false};
+  category cat{"cat1"};
+  std::thread logger([&] {
+    while (!done.load()) {
+      LOG_E(cat) << "toggled" << std::endl;
+      LOG_E("cat2") << "toggled" << std::endl;
+    }
+  });
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 2) {
+      unblock("*");
+    } else {
+      block(i % 4 ? "cat1" : "cat2");
+    }
+    std::this_thread::yield();
+  }
+  block("*");
+  done.store(true);
+  logger.join();
+  async_counters c = stop_async();
+  ::close(o.fd);
+  EXPECT_TRUE(blocked("cat1"));
+  EXPECT_TRUE(blocked("cat2"));
+  EXPECT_EQ(0u, c.errors);
+}
+
+class AsyncTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    ASSERT_EQ(0, ::pipe(fds_));
+  }
+  virtual void TearDown() {
+    ::close(fds_[0]);
+  }
+  //stops the backend, then reads everything it wrote
+  std::string drain(async_counters& c) {
+    c = stop_async();
+    ::close(fds_[1]);
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fds_[0], buf, sizeof buf)) > 0) out.append(buf, n);
+    return out;
+  }
+  //32 bytes per record, the pipe must hold all of them
+  void storm(int threads, int records) {
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+      pool.emplace_back([=] {
+        for (int i = 0; i < records; ++i) async_write("0123456789abcdefghijklmnopqrstu\n", 32);
+      });
+    }
+    for (auto& t : pool) t.join();
+  }
+  int fds_[2];
+};
+
+TEST_F(AsyncTest, off_by_default) {
+  EXPECT_FALSE(async_enabled());
+  EXPECT_FALSE(async_write("x", 1));
+}
+
+TEST_F(AsyncTest, block_keeps_every_record) {
+  async_options o;
+  o.fd = fds_[1];
+  o.buffer_size = 256;
+  o.policy = overflow::block;
+  start_async(o);
+  EXPECT_TRUE(async_enabled());
+  storm(4, 250);
+  async_counters c;
+  std::string out = drain(c);
+  EXPECT_EQ(1000u, c.records);
+  EXPECT_EQ(0u, c.dropped);
+  EXPECT_EQ(32000u, c.bytes);
+  EXPECT_EQ(32000u, out.size());
+  for (std::size_t i = 0; i < out.size(); i += 32) {
+    ASSERT_EQ("0123456789abcdefghijklmnopqrstu\n", out.substr(i, 32));
+  }
+}
+
+TEST_F(AsyncTest, drop_never_tears_records) {
+  async_options o;
+  o.fd = fds_[1];
+  o.buffer_size = 64;
+  o.policy = overflow::drop;
+  start_async(o);
+  storm(2, 500);
+  async_counters c;
+  std::string out = drain(c);
+  EXPECT_EQ(1000u, c.records + c.dropped);
+  EXPECT_EQ(c.records * 32, out.size());
+  for (std::size_t i = 0; i < out.size(); i += 32) {
+    ASSERT_EQ("0123456789abcdefghijklmnopqrstu\n", out.substr(i, 32));
+  }
+}
+
+TEST_F(AsyncTest, sample_and_oversized) {
+  async_options o;
+  o.fd = fds_[1];
+  o.buffer_size = 128;
+  o.policy = overflow::sample;
+  o.sample_rate = 4;
+  start_async(o);
+  EXPECT_FALSE(async_write(std::string(200, 'x').data(), 200));
+  storm(1, 1000);
+  async_counters c;
+  std::string out = drain(c);
+  EXPECT_EQ(1001u, c.records + c.dropped);
+  EXPECT_EQ(c.records * 32, out.size());
+}
+
+TEST_F(AsyncTest, log_statements) {
+  async_options o;
+  o.fd = fds_[1];
+  start_async(o);
+  add("cat1");
+  unblock("cat1");
+  LOG_I("cat1") << "async " << 42 << std::endl;
+  async_counters c;
+  std::string out = drain(c);
+  EXPECT_EQ(1u, c.records);
+  EXPECT_NE(std::string::npos, out.find("[cat1]"));
+  EXPECT_NE(std::string::npos, out.find("async 42\n"));
+}
+
+//one call site, a different category on every call
+static void log_runtime_category(const char* category, int n) {
+  LOG_I(category) << "runtime " << n << std::endl;
+}
+
+//one call site, a different handle on every call
+static void log_handle(const category& c, int n) {
+  LOG_I(c) << "handle " << n << std::endl;
+}
+
+TEST_F(AsyncTest, handle_per_call) {
+  async_options o;
+  o.fd = fds_[1];
+  start_async(o);
+  reset();
+  category a{"cat1"};
+  category b{"cat2"};
+  unblock("cat1");
+  log_handle(a, 1);
+  log_handle(b, 2); //blocked, though a passed first
+  block("cat1");
+  unblock("cat2");
+  log_handle(a, 3); //blocked
+  log_handle(b, 4);
+  async_counters c;
+  std::string out = drain(c);
+  EXPECT_EQ(2u, c.records);
+  EXPECT_NE(std::string::npos, out.find("[cat1]"));
+  EXPECT_NE(std::string::npos, out.find("handle 1\n"));
+  EXPECT_EQ(std::string::npos, out.find("handle 2"));
+  EXPECT_EQ(std::string::npos, out.find("handle 3"));
+  EXPECT_NE(std::string::npos, out.find("[cat2]"));
+  EXPECT_NE(std::string::npos, out.find("handle 4\n"));
+}
+
+TEST_F(AsyncTest, runtime_category_per_call) {
+  async_options o;
+  o.fd = fds_[1];
+  start_async(o);
+  reset();
+  unblock("cat1");
+  unblock("cat3");
+  log_runtime_category("cat1", 1);
+  log_runtime_category("cat2", 2);
+  log_runtime_category(std::string("cat3").c_str(), 3);
+  async_counters c;
+  std::string out = drain(c);
+  EXPECT_EQ(2u, c.records);
+  EXPECT_NE(std::string::npos, out.find("[cat1]"));
+  EXPECT_EQ(std::string::npos, out.find("[cat2]"));
+  EXPECT_EQ(std::string::npos, out.find("runtime 2"));
+  EXPECT_NE(std::string::npos, out.find("[cat3]"));
+  EXPECT_NE(std::string::npos, out.find("runtime 3\n"));
+}
+
+
+TEST(LogTime, current_time) {
+  EXPECT_EQ(".234", to_time(1234000000).substr(8));
+  EXPECT_EQ(12u, current_time().size());
+  EXPECT_EQ(':', current_time()[2]);
+  EXPECT_EQ(current_thread(), current_thread());
+}
+
+TEST(BinaryLog, round_trip) {
+  const char* path = "binary_test.bin";
+  add("bin");
+  unblock("bin");
+  enable(true);
+  set_level(level::debug);
+  LOG_BIN_I("bin", "before start {}", 1); //registered, not written
+  ASSERT_TRUE(start_binary(path));
+  EXPECT_TRUE(binary_enabled());
+  std::string name = "name";
+  for (int i = 0; i < 3; ++i) {
+    LOG_BIN_I("bin", "i={} s={} d={} b={}", i, name, 0.5, i == 1);
+  }
+  LOG_BIN_W("bin", "no arguments");
+  LOG_BIN_E("bin", "extra", -7L, 'c');
+  LOG_I("bin") << "text record" << std::endl;
+  block("bin");
+  LOG_BIN_I("bin", "blocked {}", 0);
+  async_counters c = stop_binary();
+  EXPECT_FALSE(binary_enabled());
+  EXPECT_EQ(6u, c.records);
+  EXPECT_EQ(0u, c.dropped);
+
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  ASSERT_TRUE(decode(in, out));
+  std::string text = out.str();
+  ::unlink(path);
+  EXPECT_EQ(std::string::npos, text.find("before start"));
+  EXPECT_EQ(std::string::npos, text.find("blocked"));
+  EXPECT_NE(std::string::npos, text.find("i=0 s=name d=0.5 b=false\n"));
+  EXPECT_NE(std::string::npos, text.find("i=1 s=name d=0.5 b=true\n"));
+  EXPECT_LT(text.find("i=0 "), text.find("i=2 "));
+  EXPECT_NE(std::string::npos, text.find(" W \e[0m [bin] "));
+  EXPECT_NE(std::string::npos, text.find("test.cpp:"));
+  EXPECT_NE(std::string::npos, text.find(" - no arguments\n"));
+  EXPECT_NE(std::string::npos, text.find(" - extra -7 c\n"));
+  EXPECT_NE(std::string::npos, text.find(" - text record\n"));
+  EXPECT_NE(std::string::npos, text.find("[" + current_thread() + "]"));
+}
+
+TEST(BinaryLog, unwritable_sink) {
+  EXPECT_FALSE(start_binary("/dev/full"));
+  EXPECT_FALSE(binary_enabled());
+}
+
+TEST(BinaryLog, not_a_binary_log) {
+  std::istringstream in("plain text");
+  std::ostringstream out;
+  EXPECT_FALSE(decode(in, out));
+}
+
 }
 
@@ -0,0 +1,141 @@
+// g++ -O2 -std=c++17 -Wall -Wextra -pthread mpmc_queue.cpp
+
+#include "mpmc_queue.h"
+#include "queue1.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ITEMS 1'000'000
+
+void test_queue() {
+	x::MpmcQueue<std::string> q{3};
+	assert(q.capacity() == 4);
+	std::string s;
+	assert(!q.try_pop(s));
+	assert(q.try_push("a"));
+	assert(q.try_push(std::string(100, 'b')));
+	assert(q.try_emplace(3, 'c'));
+	assert(q.try_push("d"));
+	assert(!q.try_push("e")); // full
+	assert(q.try_pop(s) && s == "a");
+	assert(q.try_pop(s) && s == std::string(100, 'b'));
+	assert(q.pop() == "ccc");
+	q.push("f");
+	assert(q.pop() == "d");
+	assert(q.pop() == "f");
+	assert(!q.try_pop(s));
+
+	// move-only
+	x::MpmcQueue<std::unique_ptr<int>> q2{2};
+	q2.push(std::make_unique<int>(42));
+	assert(*q2.pop() == 42);
+
+	// no default constructor
+	struct Item {
+		explicit Item(int v) : v{v} { }
+		int v;
+	};
+	x::MpmcQueue<Item> q3{2};
+	q3.push(Item{1});
+	assert(q3.try_emplace(2));
+	assert(q3.pop().v == 1);
+
+	// items still queued are destroyed with the queue, also across the wrap
+	auto left = std::make_shared<int>(0);
+	std::shared_ptr<int> one;
+	{
+		x::MpmcQueue<std::shared_ptr<int>> q4{4};
+		for (int i = 0; i < 3; ++i) q4.push(left);
+		assert(q4.try_pop(one));
+		q4.push(left);
+		q4.push(left);
+		assert(left.use_count() == 6);
+	}
+	assert(left.use_count() == 2);
+}
+
+// blocking producers/consumers through a tiny queue, every item exactly once
+void test_threads(int producers, int consumers) {
+	x::MpmcQueue<int> q{8};
+	std::vector<std::thread> threads;
+	std::atomic<long long> sum{0};
+	const int per_producer = 100'000;
+	for (int p = 0; p < producers; ++p) {
+		threads.emplace_back([&q, p] {
+			for (int i = 0; i < per_producer; ++i) q.push(p * per_producer + i + 1);
+		});
+	}
+	const int total = producers * per_producer;
+	for (int c = 0; c < consumers; ++c) {
+		threads.emplace_back([&, c] {
+			int n = total / consumers + (c < total % consumers ? 1 : 0);
+			long long local = 0;
+			for (int i = 0; i < n; ++i) local += q.pop();
+			sum += local;
+		});
+	}
+	for (auto& t : threads) t.join();
+	assert(sum == (long long)total * (total + 1) / 2);
+}
+
+// P producers and P consumers move ITEMS ints, items/s
+template <typename Push, typename Pop>
+double bench(int threads, Push push, Pop pop) {
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	for (int t = 0; t < threads; ++t) {
+		workers.emplace_back([=] {
+			for (int i = 0; i < ITEMS / threads; ++i) push(i);
+		});
+		workers.emplace_back([=] {
+			for (int i = 0; i < ITEMS / threads; ++i) pop();
+		});
+	}
+	for (auto& w : workers) w.join();
+	auto end = std::chrono::steady_clock::now();
+	return (ITEMS / threads * threads) / std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+	test_queue();
+	test_threads(1, 1);
+	test_threads(3, 2);
+	test_threads(2, 5);
+
+	int max_threads = std::max(4u, std::thread::hardware_concurrency());
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		x::MpmcQueue<int> mpmc{1024};
+		double mpmc_rate = bench(threads,
+			[&](int v) { mpmc.push(v); },
+			[&] { return mpmc.pop(); });
+
+		x::Queue<int> mutex_queue;
+		double mutex_rate = bench(threads,
+			[&](int v) { mutex_queue.push(v); },
+			[&] {
+				for (;;) {
+					if (mutex_queue.empty()) {
+						std::this_thread::yield();
+						continue;
+					}
+					try {
+						return mutex_queue.pop();
+					} catch (const std::runtime_error&) {
+						// lost the race for the last item
+					}
+				}
+			});
+
+		std::cout << threads << "+" << threads << " threads - mpmc: " << mpmc_rate / 1e6
+		          << " Mitems/s, mutex: " << mutex_rate / 1e6 << " Mitems/s" << std::endl;
+	}
+
+	std::cout << "ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace x {
+
+// bounded multi-producer/multi-consumer lock-free queue
+// (Dmitry Vyukov's design: every slot carries a sequence number that tells
+// producers and consumers whose turn it is, so each side only CASes its own
+// cursor). Capacity is rounded up to a power of two.
+// push()/pop() spin, then yield, then block on a futex when the queue is
+// full/empty. push()/pop() only need T to be move constructible.
+template <typename T> class MpmcQueue {
+public:
+	explicit MpmcQueue(size_t capacity) : mask_{round_up(capacity) - 1}, cells_{new Cell[mask_ + 1]} {
+		for (size_t i = 0; i <= mask_; ++i) {
+			cells_[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpmcQueue(const MpmcQueue&) = delete;
+
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	// no push/pop may be running
+	~MpmcQueue() {
+		const size_t end = push_pos_.load(std::memory_order_relaxed);
+		for (size_t pos = pop_pos_.load(std::memory_order_relaxed); pos != end; ++pos) {
+			item(cells_[pos & mask_])->~T();
+		}
+		delete[] cells_;
+	}
+
+	size_t capacity() const noexcept { return mask_ + 1; }
+
+	template <typename... Args> bool try_emplace(Args&&... args) {
+		size_t pos = push_pos_.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;) {
+			cell = &cells_[pos & mask_];
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (dif == 0) {
+				if (push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+			} else if (dif < 0) {
+				return false; // full
+			} else {
+				pos = push_pos_.load(std::memory_order_relaxed);
+			}
+		}
+		new (cell->storage) T(std::forward<Args>(args)...);
+		cell->seq.store(pos + 1, std::memory_order_release);
+		pushed_.notify();
+		return true;
+	}
+
+	bool try_push(const T& v) { return try_emplace(v); }
+
+	bool try_push(T&& v) { return try_emplace(std::move(v)); }
+
+	bool try_pop(T& v) {
+		return try_consume([&](T&& item) { v = std::move(item); });
+	}
+
+	void push(const T& v) {
+		T copy{v};
+		push(std::move(copy));
+	}
+
+	void push(T&& v) {
+		for (int spin = 0;; ++spin) {
+			if (try_push(std::move(v))) return;
+			if (backoff(spin)) continue;
+			uint32_t epoch = popped_.prepare_wait();
+			if (!full()) {
+				popped_.cancel_wait();
+				continue;
+			}
+			popped_.wait(epoch);
+		}
+	}
+
+	T pop() {
+		std::optional<T> v;
+		auto take = [&](T&& item) { v.emplace(std::move(item)); };
+		for (int spin = 0;; ++spin) {
+			if (try_consume(take)) return std::move(*v);
+			if (backoff(spin)) continue;
+			uint32_t epoch = pushed_.prepare_wait();
+			if (!empty()) {
+				pushed_.cancel_wait();
+				continue;
+			}
+			pushed_.wait(epoch);
+		}
+	}
+
+private:
+	static constexpr size_t CACHE_LINE = 64;
+	static constexpr int SPINS = 64;
+	static constexpr int YIELDS = 16;
+
+	// false when it is time to sleep
+	static bool backoff(int spin) {
+		if (spin < SPINS) return true;
+		if (spin < SPINS + YIELDS) {
+			std::this_thread::yield();
+			return true;
+		}
+		return false;
+	}
+
+	static size_t round_up(size_t n) {
+		if (n < 2) n = 2;
+		size_t pow2 = 1;
+		while (pow2 < n) pow2 <<= 1;
+		return pow2;
+	}
+
+	struct Cell {
+		std::atomic<size_t> seq;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	static T* item(Cell& cell) { return std::launder(reinterpret_cast<T*>(cell.storage)); }
+
+	// hands the oldest item to sink as an rvalue, then destroys it in place
+	template <typename Sink> bool try_consume(Sink&& sink) {
+		size_t pos = pop_pos_.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;) {
+			cell = &cells_[pos & mask_];
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+			if (dif == 0) {
+				if (pop_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+			} else if (dif < 0) {
+				return false; // empty
+			} else {
+				pos = pop_pos_.load(std::memory_order_relaxed);
+			}
+		}
+		T* value = item(*cell);
+		sink(std::move(*value));
+		value->~T();
+		cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+		popped_.notify();
+		return true;
+	}
+
+	// what a waiter checks after prepare_wait(): a push or pop that claimed
+	// its slot (cursor CAS) before the check is seen here, later ones see the
+	// waiter in notify(); stale reads only make the waiter retry
+	bool empty() const {
+		return push_pos_.load(std::memory_order_seq_cst) == pop_pos_.load(std::memory_order_relaxed);
+	}
+
+	bool full() const {
+		// pop first: the cursors only grow and pop never passes push
+		const size_t pop = pop_pos_.load(std::memory_order_seq_cst);
+		return push_pos_.load(std::memory_order_relaxed) - pop > mask_;
+	}
+
+	// futex based event count: waiters sleep on the epoch word, notify only
+	// touches the epoch and makes a syscall when someone is waiting.
+	// No fence on the notify side: the cursor CAS of the push/pop that
+	// notifies and the waiters load are both seq_cst, and prepare_wait()
+	// fences before the waiter looks at the cursors, so either the notifier
+	// sees the waiter or the waiter sees the claimed slot.
+	struct alignas(CACHE_LINE) Event {
+		std::atomic<uint32_t> epoch{0};
+		std::atomic<uint32_t> waiters{0};
+
+		uint32_t prepare_wait() {
+			waiters.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			return epoch.load(std::memory_order_relaxed);
+		}
+
+		void cancel_wait() { waiters.fetch_sub(1, std::memory_order_relaxed); }
+
+		void wait(uint32_t expected) {
+			syscall(SYS_futex, &epoch, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+			waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void notify() {
+			if (waiters.load(std::memory_order_seq_cst) != 0) {
+				epoch.fetch_add(1, std::memory_order_relaxed);
+				syscall(SYS_futex, &epoch, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+			}
+		}
+	};
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+
+	alignas(CACHE_LINE) std::atomic<size_t> push_pos_{0};
+	alignas(CACHE_LINE) std::atomic<size_t> pop_pos_{0};
+	alignas(CACHE_LINE) const size_t mask_;
+	Cell* const cells_;
+	Event pushed_;
+	Event popped_;
+};
+
+} // namespace x
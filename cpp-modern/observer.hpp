@@ -4,8 +4,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 template <typename T, typename... A>
@@ -29,3 +35,287 @@ class Observable {
   // expired shared pointers tracking
   std::vector<std::weak_ptr<F>> slot;
 };
+
+// Minimal user space RCU: readers publish the epoch they entered in, in a
+// slot of their own (plain stores, no shared read-modify-write), writers
+// retire old data tagged with the epoch they bumped and free it once every
+// active reader entered after that.
+namespace rcu {
+
+struct Reader {
+  std::atomic<uint64_t> epoch{0};  // 0: not reading
+  std::atomic<bool> used{true};
+  unsigned depth = 0;  // owner only, for nested read sections
+};
+
+class Domain {
+ public:
+  static Domain& instance() {
+    static Domain domain;
+    return domain;
+  }
+
+  Reader* acquire() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& r : readers_) {
+      bool expected = false;
+      if (r->used.compare_exchange_strong(expected, true)) return r.get();
+    }
+    readers_.emplace_back(new Reader);
+    return readers_.back().get();
+  }
+
+  void release(Reader* r) { r->used.store(false, std::memory_order_release); }
+
+  uint64_t current() const { return epoch_.load(std::memory_order_relaxed); }
+
+  // returns the epoch data retired now is tagged with
+  uint64_t advance() { return epoch_.fetch_add(1, std::memory_order_seq_cst); }
+
+  // epoch of the oldest active reader, data retired before it is
+  // unreachable
+  uint64_t oldest() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint64_t oldest = UINT64_MAX;
+    for (const auto& r : readers_) {
+      uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+      if (e != 0 && e < oldest) oldest = e;
+    }
+    return oldest;
+  }
+
+ private:
+  std::atomic<uint64_t> epoch_{1};
+  std::mutex mtx_;  // registration and scans, never taken by readers
+  std::vector<std::unique_ptr<Reader>> readers_;
+};
+
+// read side critical section
+class Guard {
+ public:
+  Guard() : r_{local()} {
+    if (r_->depth++ == 0) {
+      r_->epoch.store(Domain::instance().current(), std::memory_order_relaxed);
+      // pairs with the seq_cst publish and scan of the writers
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  ~Guard() {
+    if (--r_->depth == 0) r_->epoch.store(0, std::memory_order_release);
+  }
+
+  Guard(const Guard&) = delete;
+  Guard& operator=(const Guard&) = delete;
+
+ private:
+  static Reader* local() {
+    struct Slot {
+      Reader* r = Domain::instance().acquire();
+      ~Slot() { Domain::instance().release(r); }
+    };
+    static thread_local Slot slot;
+    return slot.r;
+  }
+
+  Reader* r_;
+};
+
+}  // namespace rcu
+
+// Thread-safe Observable: observers live in an immutable snapshot that
+// attach/detach copy, modify and swap in. The snapshot lists plain pointers to
+// one node per observer, and the node holds the observable's only reference
+// to the callable, so notify() takes no lock and does no atomic
+// read-modify-write: it loads the snapshot and reads each use_count(). A
+// count of 1 means the owner dropped the observer; it is skipped, and the
+// next attach/detach/compact unlists it. Unlisted nodes and old snapshots are
+// freed once no reader can still see them, so a callable outlives its owner
+// by at most that grace period.
+template <typename T, typename... A>
+class ConcurrentObservable {
+  using F = std::function<void(A... args)>;
+
+  struct Node {
+    std::shared_ptr<F> fn;
+  };
+
+  struct Snapshot {
+    std::vector<const Node*> slots;
+  };
+
+  // what one update unpublished
+  struct Retired {
+    uint64_t epoch;
+    const Snapshot* snapshot;
+    std::vector<const Node*> nodes;
+  };
+
+ public:
+  ConcurrentObservable() : current_{new Snapshot} {}
+
+  ConcurrentObservable(const ConcurrentObservable&) = delete;
+  ConcurrentObservable& operator=(const ConcurrentObservable&) = delete;
+
+  // no notify() may be running
+  ~ConcurrentObservable() {
+    const Snapshot* s = current_.load(std::memory_order_relaxed);
+    for (const Node* n : s->slots) delete n;
+    delete s;
+    for (auto& r : retired_) destroy(r);
+  }
+
+  void attach(std::weak_ptr<F> f) {
+    std::shared_ptr<F> fn = f.lock();
+    if (!fn) return;
+    update([&](std::vector<const Node*>& slots, std::vector<const Node*>&) {
+      slots.push_back(new Node{std::move(fn)});
+    });
+  }
+
+  void detach(const std::shared_ptr<F>& f) {
+    update([&](std::vector<const Node*>& slots, std::vector<const Node*>& dropped) {
+      for (auto it = slots.begin(); it != slots.end(); ++it) {
+        if (!(*it)->fn.owner_before(f) && !f.owner_before((*it)->fn)) {
+          dropped.push_back(*it);
+          slots.erase(it);
+          break;
+        }
+      }
+    });
+  }
+
+  // drops observers whose owner is gone
+  void compact() {
+    update([](std::vector<const Node*>&, std::vector<const Node*>&) {});
+  }
+
+  void notify(A... args) const {
+    rcu::Guard guard;
+    const Snapshot* s = current_.load(std::memory_order_acquire);
+    for (const Node* n : s->slots) {
+      if (n->fn.use_count() > 1) {
+        (*n->fn)(args...);
+      } else if (!expired_.load(std::memory_order_relaxed)) {
+        expired_.store(true, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t size() const {
+    rcu::Guard guard;
+    return current_.load(std::memory_order_acquire)->slots.size();
+  }
+
+  // a notify() saw an observer without owner, compact() would drop it
+  bool expired() const { return expired_.load(std::memory_order_relaxed); }
+
+ private:
+  template <typename Edit>
+  void update(Edit edit) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const Snapshot* old = current_.load(std::memory_order_relaxed);
+    auto next = new Snapshot;
+    std::vector<const Node*> dropped;
+    next->slots.reserve(old->slots.size() + 1);
+    for (const Node* n : old->slots) {
+      if (n->fn.use_count() > 1) {
+        next->slots.push_back(n);
+      } else {
+        dropped.push_back(n);
+      }
+    }
+    expired_.store(false, std::memory_order_relaxed);
+    edit(next->slots, dropped);
+    current_.store(next, std::memory_order_seq_cst);
+    retired_.push_back(Retired{rcu::Domain::instance().advance(), old, std::move(dropped)});
+    reclaim();
+  }
+
+  // called with mtx_ held; retired_ is in epoch order
+  void reclaim() {
+    const uint64_t oldest = rcu::Domain::instance().oldest();
+    auto end = retired_.begin();
+    while (end != retired_.end() && end->epoch < oldest) destroy(*end++);
+    retired_.erase(retired_.begin(), end);
+  }
+
+  static void destroy(const Retired& r) {
+    for (const Node* n : r.nodes) delete n;
+    delete r.snapshot;
+  }
+
+  std::atomic<const Snapshot*> current_;
+  mutable std::atomic<bool> expired_{false};
+  std::mutex mtx_;  // writers only
+  std::vector<Retired> retired_;
+};
+
+// Non-owning reference to any callable with a matching signature: an object
+// pointer (or, for a plain function, the function pointer) plus a plain
+// trampoline pointer, never allocates. A callable object must outlive the
+// function_ref.
+template <typename Signature>
+class function_ref;
+
+template <typename R, typename... A>
+class function_ref<R(A...)> {
+  // a function pointer does not fit in a void* portably
+  union target {
+    void* obj;
+    void (*fn)();
+  };
+
+ public:
+  template <typename C, typename = std::enable_if_t<
+                            !std::is_same<std::decay_t<C>, function_ref>::value &&
+                            !std::is_function<C>::value &&
+                            std::is_invocable_r<R, C&, A...>::value>>
+  function_ref(C& callable) noexcept
+      : target_{const_cast<void*>(static_cast<const void*>(std::addressof(callable)))},
+        call_{[](target t, A... args) -> R {
+          return (*static_cast<C*>(t.obj))(std::forward<A>(args)...);
+        }} {}
+
+  // plain functions, by name or by pointer
+  template <typename F, typename = std::enable_if_t<std::is_function<F>::value &&
+                                                    std::is_invocable_r<R, F*, A...>::value>>
+  function_ref(F* fn) noexcept
+      : call_{[](target t, A... args) -> R {
+          return reinterpret_cast<F*>(t.fn)(std::forward<A>(args)...);
+        }} {
+    target_.fn = reinterpret_cast<void (*)()>(fn);
+  }
+
+  R operator()(A... args) const { return call_(target_, std::forward<A>(args)...); }
+
+ private:
+  target target_;
+  R (*call_)(target, A...);
+};
+
+// Observable whose listeners are fixed at compile time: the type list is the
+// template arguments, the listeners are held by value and notify() calls
+// each of them directly, so the whole fan-out can be inlined.
+template <typename... Listeners>
+class static_observable {
+ public:
+  static_observable() = default;
+
+  explicit static_observable(Listeners... listeners)
+      : listeners_{std::move(listeners)...} {}
+
+  template <typename... A>
+  void notify(const A&... args) {
+    std::apply([&](auto&... listener) { (listener(args...), ...); },
+               listeners_);
+  }
+
+  template <typename L>
+  L& get() {
+    return std::get<L>(listeners_);
+  }
+
+ private:
+  std::tuple<Listeners...> listeners_;
+};
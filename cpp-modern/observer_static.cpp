@@ -0,0 +1,114 @@
+// g++ -O2 -std=c++17 -Wall -Wextra observer_static.cpp
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "observer.hpp"
+
+// tick listeners, each keeps a little state
+struct Sum {
+  long value = 0;
+  void operator()(int x, float) { value += x; }
+};
+
+struct Max {
+  int value = 0;
+  void operator()(int x, float) { value = x > value ? x : value; }
+};
+
+struct Count {
+  long value = 0;
+  void operator()(int, float) { ++value; }
+};
+
+struct Volume {
+  double value = 0;
+  void operator()(int, float y) { value += y; }
+};
+
+class TickObserver;
+
+static int triple(int x) { return 3 * x; }
+
+using F = std::function<void(int, float)>;
+
+void test() {
+  static_observable<Sum, Max, Count> ticks;
+  ticks.notify(3, 1.0f);
+  ticks.notify(5, 1.0f);
+  assert(ticks.get<Sum>().value == 8);
+  assert(ticks.get<Max>().value == 5);
+  assert(ticks.get<Count>().value == 2);
+
+  int calls = 0;
+  auto lambda = [&calls](int x, float) { calls += x; };
+  function_ref<void(int, float)> ref = lambda;
+  ref(2, 0.0f);
+  Sum sum;
+  std::vector<function_ref<void(int, float)>> delegates{ref, sum};
+  for (auto& d : delegates) d(3, 0.0f);
+  assert(calls == 5);
+  assert(sum.value == 3);
+
+  auto doubler = [](int x) { return 2 * x; };
+  function_ref<long(int)> twice = doubler;  // return value converts
+  assert(twice(21) == 42);
+
+  // plain functions have no object to point to, they are kept by pointer
+  function_ref<long(int)> thrice = triple;
+  assert(thrice(14) == 42);
+  int (*fp)(int) = &triple;
+  function_ref<long(int)> by_pointer = fp;
+  assert(by_pointer(2) == 6);
+}
+
+template <typename Notify>
+double bench(int events, Notify notify) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < events; ++i) {
+    int x = i;
+    asm volatile("" : "+r"(x));  // keep the loop from being folded away
+    notify(x, 0.5f);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / events;
+}
+
+int main() {
+  test();
+
+  const int events = 10000000;
+  Sum sum;
+  Max max;
+  Count count;
+  Volume volume;
+
+  // observer_example.cpp pattern: weak_ptr<std::function> per listener
+  Observable<TickObserver, int, float> dynamic;
+  std::vector<std::shared_ptr<F>> owners = {
+      std::make_shared<F>(std::ref(sum)), std::make_shared<F>(std::ref(max)),
+      std::make_shared<F>(std::ref(count)), std::make_shared<F>(std::ref(volume))};
+  for (auto& f : owners) dynamic.attach(f);
+  double t1 = bench(events, [&](int x, float y) { dynamic.notify(x, y); });
+
+  std::vector<function_ref<void(int, float)>> delegates{sum, max, count, volume};
+  double t2 = bench(events, [&](int x, float y) {
+    for (auto& d : delegates) d(x, y);
+  });
+
+  static_observable<Sum, Max, Count, Volume> fixed;
+  double t3 = bench(events, [&](int x, float y) { fixed.notify(x, y); });
+
+  assert(fixed.get<Sum>().value == sum.value / 2);
+  assert(fixed.get<Count>().value == count.value / 2);
+
+  std::cout << "4 listeners, ns per event" << std::endl;
+  std::cout << "Observable (weak_ptr<std::function>): " << t1 << std::endl;
+  std::cout << "vector<function_ref>:                 " << t2 << std::endl;
+  std::cout << "static_observable:                    " << t3 << std::endl;
+
+  std::cout << "ok" << std::endl;
+  return 0;
+}
@@ -24,14 +24,14 @@ public:
 		q_.push(v);
 	}
 
-	T&& pop() {
+	T pop() {
 		std::lock_guard<std::mutex> lock(mtx_);
 		if (q_.empty()) {
 			throw std::runtime_error("Pop from empty Queue.");
 		}
-		T x = q_.front();
+		T x = std::move(q_.front());
 		q_.pop();
-		return std::move(x);
+		return x;
 	}
 
 	bool empty() const noexcept {
@@ -1,12 +1,15 @@
 // clang++ -O3 -g3 -Xclang -flto-visibility-public-std ring_queue.cpp
 // mingw32-g++ -O3 -g3 -std=c++14 ring_queue.cpp
+// g++ -O2 -std=c++17 ring_queue.cpp
 
 #include "ring_queue.hpp"
 
 #include <chrono>
+#include <deque>
 #include <iostream>
 #include <list>
 #include <queue>
+#include <string>
 // #include <memory>
 // #include <vector>
 
@@ -126,10 +129,132 @@ void test_rb() {
   rb3.print();
   rb3.push(10);
   rb3.print();
+  assert(8 == rb3.capacity());
+}
+
+// counts live objects to catch double destruction and leaks
+struct tracked {
+  static int alive;
+  std::string s;
+  explicit tracked(int i) : s(std::to_string(i)) { ++alive; }
+  tracked(const tracked& o) : s(o.s) { ++alive; }
+  tracked(tracked&& o) noexcept : s(std::move(o.s)) { ++alive; }
+  tracked& operator=(const tracked&) = default;
+  tracked& operator=(tracked&&) = default;
+  ~tracked() { --alive; }
+};
+
+int tracked::alive = 0;
+
+template <class T>
+struct counting_allocator {
+  using value_type = T;
+  static int allocations;
+  counting_allocator() = default;
+  template <class U>
+  counting_allocator(const counting_allocator<U>&) {}
+  T* allocate(size_t n) {
+    ++allocations;
+    return std::allocator<T>{}.allocate(n);
+  }
+  void deallocate(T* p, size_t n) {
+    --allocations;
+    std::allocator<T>{}.deallocate(p, n);
+  }
+  bool operator==(const counting_allocator&) const { return true; }
+  bool operator!=(const counting_allocator&) const { return false; }
+};
+
+template <class T>
+int counting_allocator<T>::allocations = 0;
+
+void test_storage() {
+  {
+    ring_queue<tracked, counting_allocator<tracked>> q{3};
+    assert(4 == q.capacity());
+    assert(0 == tracked::alive);  // no default constructed slots
+    for (int i = 0; i < 3; ++i) q.emplace_back(i);
+    tracked t{100};
+    assert(q.pop_into(t) && t.s == "0");
+    for (int i = 3; i < 10; ++i) q.emplace_back(i);  // wraps, then grows
+    assert(16 == q.capacity());
+    assert(9 == q.size());
+    assert(10 == tracked::alive);
+
+    auto copy = q;
+    assert(19 == tracked::alive);
+    auto moved = std::move(copy);
+    assert(copy.empty() && 9 == moved.size());
+    copy = moved;  // moved-from objects can be assigned again
+    for (int i = 1; i < 10; ++i) {
+      assert(std::to_string(i) == q.pop().s);
+      assert(std::to_string(i) == moved.front().s);
+      moved.pop();
+    }
+    assert(!q.pop_into(t));
+    assert(9 == copy.size());
+    copy.clear();
+    assert(1 == tracked::alive);
+    assert(3 == counting_allocator<tracked>::allocations);
+  }
+  assert(0 == tracked::alive);
+  assert(0 == counting_allocator<tracked>::allocations);
+
+  // memcpy relocation keeps the order across the wrap point
+  ring_queue<int> q{4};
+  for (int i = 0; i < 4; ++i) q.push(i);
+  q.pop();
+  q.pop();
+  q.push(4);
+  q.push(5);
+  q.push(6);  // grows with head in the middle
+  for (int i = 2; i <= 6; ++i) assert(i == q.pop());
+
+  // pushing an element of a full queue, the argument outlives the old buffer
+  ring_queue<tracked> full{2};
+  full.emplace_back(1);
+  full.emplace_back(2);
+  full.push(full.front());
+  assert(4 == full.capacity());
+  assert("1" == full.pop().s && "2" == full.pop().s && "1" == full.pop().s);
+}
+
+struct large {
+  char bytes[256];
+};
+
+// `rounds` of: push `depth` items, pop them all
+template <class Queue, class T>
+long fifo(Queue& q, const T& item, int rounds, int depth) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (int i = 0; i < depth; ++i) q.push(item);
+    for (int i = 0; i < depth; ++i) q.pop();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+template <class T>
+void bench_fifo(const char* name, int rounds, int depth) {
+  T item{};
+  ring_queue<T> rq;
+  std::queue<T, std::deque<T>> dq;
+  fifo(rq, item, 1, depth);  // warm up, both keep their storage
+  fifo(dq, item, 1, depth);
+  long rq_us = fifo(rq, item, rounds, depth);
+  long dq_us = fifo(dq, item, rounds, depth);
+  std::cout << name << " depth " << depth << ": ring_queue " << rq_us << "us, deque " << dq_us << "us" << std::endl;
 }
 
 int main() {
   test_rb();
+  test_storage();
+
+  bench_fifo<int>("int", 1000, 1000);
+  bench_fifo<int>("int", 10, 100000);
+  bench_fifo<large>("256B", 1000, 1000);
+  bench_fifo<large>("256B", 10, 100000);
 
   S s{};
 
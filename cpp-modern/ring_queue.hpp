@@ -1,87 +1,220 @@
 // ring buffer queue
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
-template <class T>
+// FIFO over a growable ring of raw storage: slots are constructed on push and
+// destroyed on pop, the capacity is always a power of two (index & mask) and
+// doubles when full. Trivially copyable elements are relocated with memcpy.
+template <class T, class Allocator = std::allocator<T>>
 class ring_queue {
+  using traits = std::allocator_traits<Allocator>;
+
  public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
   ring_queue() : ring_queue{2} {}
 
-  ring_queue(size_t capacity)
-      : capacity{std::max(capacity, 2u)},
+  explicit ring_queue(size_t capacity, const Allocator& alloc = Allocator())
+      : alloc_{alloc},
+        capacity_{round_up(capacity)},
+        mask_{capacity_ - 1},
+        head_{0},
         size_{0},
-        begin{0},
-        end{0},
-        buffer{new T[capacity]} {}
-  ~ring_queue() { delete[] buffer; }
+        buffer_{traits::allocate(alloc_, capacity_)} {}
+
+  ring_queue(const ring_queue& other)
+      : alloc_{traits::select_on_container_copy_construction(other.alloc_)},
+        capacity_{other.capacity_},
+        mask_{other.mask_},
+        head_{0},
+        size_{0},
+        buffer_{traits::allocate(alloc_, capacity_)} {
+    try {
+      for (; size_ < other.size_; ++size_) {
+        traits::construct(alloc_, buffer_ + size_, other.at(size_));
+      }
+    } catch (...) {
+      clear();
+      traits::deallocate(alloc_, buffer_, capacity_);
+      throw;
+    }
+  }
+
+  ring_queue(ring_queue&& other) noexcept
+      : alloc_{std::move(other.alloc_)},
+        capacity_{other.capacity_},
+        mask_{other.mask_},
+        head_{other.head_},
+        size_{other.size_},
+        buffer_{other.buffer_} {
+    other.capacity_ = 0;
+    other.mask_ = 0;
+    other.head_ = 0;
+    other.size_ = 0;
+    other.buffer_ = nullptr;
+  }
+
+  // copy-and-swap, the allocator goes along with the elements
+  ring_queue& operator=(ring_queue other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  ~ring_queue() {
+    clear();
+    if (buffer_) traits::deallocate(alloc_, buffer_, capacity_);
+  }
+
+  void swap(ring_queue& other) noexcept {
+    using std::swap;
+    swap(alloc_, other.alloc_);
+    swap(capacity_, other.capacity_);
+    swap(mask_, other.mask_);
+    swap(head_, other.head_);
+    swap(size_, other.size_);
+    swap(buffer_, other.buffer_);
+  }
 
   bool empty() const noexcept { return size_ == 0; }
 
   size_t size() const noexcept { return size_; }
 
-  void push(T&& item) {
-    if (size() == capacity) {
-      realloc_and_move();
-    }
-    if (end == capacity) end = 0;
-    buffer[end] = std::move(item);
-    ++end;
-    ++size_;
-  }
+  size_t capacity() const noexcept { return capacity_; }
+
+  allocator_type get_allocator() const { return alloc_; }
 
-  void push(const T& item) {
-    if (size() == capacity) {
-      realloc_and_move();
+  T& front() { return at(0); }
+
+  const T& front() const { return at(0); }
+
+  template <class... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      return grow_emplace_back(std::forward<Args>(args)...);
     }
-    if (end == capacity) end = 0;
-    buffer[end] = item;
-    ++end;
+    T* slot = buffer_ + ((head_ + size_) & mask_);
+    traits::construct(alloc_, slot, std::forward<Args>(args)...);
     ++size_;
+    return *slot;
   }
 
+  void push(T&& item) { emplace_back(std::move(item)); }
+
+  void push(const T& item) { emplace_back(item); }
+
   T pop() {
     if (empty()) throw std::runtime_error{"error: buffer is empty"};
-    size_t i = begin;
-    begin = (begin + 1) % capacity;
-    --size_;
-    return std::move(buffer[i]);
+    T item{std::move(front())};
+    destroy_front();
+    return item;
+  }
+
+  // moves the front element into `item`, false when empty
+  bool pop_into(T& item) {
+    if (empty()) return false;
+    item = std::move(front());
+    destroy_front();
+    return true;
+  }
+
+  void clear() noexcept {
+    while (size_ > 0) destroy_front();
+    head_ = 0;
   }
 
 #ifndef NDEBUG
   void print() const {
-    std::cout << "b: " << begin << ", e: " << end << ", s: " << size()
-              << ", { ";
-    const size_t sz = size();
-    for (size_t i = 0; i < sz; ++i) {
-      std::cout << buffer[(begin + i) % capacity] << " ";
+    std::cout << "b: " << head_ << ", e: " << ((head_ + size_) & mask_)
+              << ", s: " << size() << ", { ";
+    for (size_t i = 0; i < size_; ++i) {
+      std::cout << at(i) << " ";
     }
     std::cout << "} - [ ";
-    for (size_t i = 0; i < capacity; ++i) {
-      std::cout << buffer[i] << " ";
+    for (size_t i = 0; i < capacity_; ++i) {
+      // slots outside [head, head + size) hold no object
+      if (((i - head_) & mask_) < size_) {
+        std::cout << buffer_[i] << " ";
+      } else {
+        std::cout << "_ ";
+      }
     }
     std::cout << "]" << std::endl;
   }
 #endif
 
  private:
-  void realloc_and_move() {
-    //  reallocate twice the capacity and move elements
-    size_t new_capacity = static_cast<float>(capacity) * 1.5f;
-    T* new_buffer = new T[new_capacity];
-    const size_t sz = size();
-    size_t i = 0;
-    for (; i < sz; ++i) {
-      new_buffer[i] = std::move(buffer[(begin + i) % capacity]);
+  static size_t round_up(size_t n) {
+    size_t pow2 = 2;
+    while (pow2 < n) pow2 <<= 1;
+    return pow2;
+  }
+
+  T& at(size_t i) { return buffer_[(head_ + i) & mask_]; }
+
+  const T& at(size_t i) const { return buffer_[(head_ + i) & mask_]; }
+
+  void destroy_front() noexcept {
+    traits::destroy(alloc_, buffer_ + head_);
+    head_ = (head_ + 1) & mask_;
+    --size_;
+  }
+
+  // double the capacity, construct the new element behind the current ones
+  // and unwrap those to the front of the new buffer. The new element comes
+  // first: args may refer to an element of this queue (q.push(q.front())).
+  template <class... Args>
+  T& grow_emplace_back(Args&&... args) {
+    const size_t new_capacity = capacity_ ? capacity_ * 2 : 2;
+    T* new_buffer = traits::allocate(alloc_, new_capacity);
+    T* slot = new_buffer + size_;
+    try {
+      traits::construct(alloc_, slot, std::forward<Args>(args)...);
+    } catch (...) {
+      traits::deallocate(alloc_, new_buffer, new_capacity);
+      throw;
     }
-    begin = 0;
-    end = i;
-    delete[] buffer;
-    buffer = new_buffer;
-    capacity = new_capacity;
+    if constexpr (std::is_trivially_copyable<T>::value) {
+      const size_t first = std::min(size_, capacity_ - head_);
+      if (size_) {
+        std::memcpy(static_cast<void*>(new_buffer), buffer_ + head_, first * sizeof(T));
+        std::memcpy(static_cast<void*>(new_buffer + first), buffer_, (size_ - first) * sizeof(T));
+      }
+    } else {
+      size_t i = 0;
+      try {
+        for (; i < size_; ++i) {
+          traits::construct(alloc_, new_buffer + i, std::move_if_noexcept(at(i)));
+        }
+      } catch (...) {
+        while (i > 0) traits::destroy(alloc_, new_buffer + --i);
+        traits::destroy(alloc_, slot);
+        traits::deallocate(alloc_, new_buffer, new_capacity);
+        throw;
+      }
+      for (i = 0; i < size_; ++i) {
+        traits::destroy(alloc_, &at(i));
+      }
+    }
+    if (buffer_) traits::deallocate(alloc_, buffer_, capacity_);
+    buffer_ = new_buffer;
+    capacity_ = new_capacity;
+    mask_ = new_capacity - 1;
+    head_ = 0;
+    ++size_;
+    return *slot;
   }
 
+  Allocator alloc_;
+  size_t capacity_;
+  size_t mask_;
+  size_t head_;
   size_t size_;
-  size_t capacity;
-  size_t begin;
-  size_t end;
-  T* buffer;
+  T* buffer_;
 };
@@ -0,0 +1,94 @@
+// g++ -O2 -std=c++17 -Wall -Wextra -pthread thread_pool.cpp
+
+#include "thread_pool.h"
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+void test_deque() {
+	x::WorkStealingDeque<int> d{2};
+	int v;
+	assert(!d.pop(v));
+	assert(!d.steal(v));
+	for (int i = 1; i <= 5; ++i) d.push(i); // grows
+	assert(d.steal(v) && v == 1);           // FIFO for thieves
+	assert(d.pop(v) && v == 5);             // LIFO for the owner
+	assert(d.pop(v) && v == 4);
+	assert(d.steal(v) && v == 2);
+	assert(d.pop(v) && v == 3);
+	assert(d.empty());
+}
+
+void test_pool() {
+	x::ThreadPool pool{4};
+
+	auto answer = pool.submit([] { return 42; });
+	assert(answer.get() == 42);
+
+	std::atomic<int> count{0};
+	std::vector<x::ThreadPool::Closure> batch(1000, [&] { ++count; });
+	pool.post_batch(batch.begin(), batch.end());
+
+	// tasks posting tasks, joined through a future
+	std::promise<void> done;
+	std::atomic<int> pending{100};
+	for (int i = 0; i < 100; ++i) {
+		pool.post([&] {
+			pool.post([&] {
+				++count;
+				if (--pending == 0) done.set_value();
+			});
+		});
+	}
+	done.get_future().wait();
+
+	auto failed = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+	try {
+		failed.get();
+		assert(false);
+	} catch (const std::runtime_error&) {
+	}
+
+	while (count.load() != 1100) std::this_thread::yield();
+}
+
+// fan-out: each root task spawns `width` leaves that do a little work
+struct FanOut {
+	std::atomic<long> remaining;
+	std::promise<void> done;
+
+	void leaf() {
+		volatile unsigned h = 0;
+		for (unsigned i = 0; i < 200; ++i) h = h * 31 + i;
+		if (--remaining == 0) done.set_value();
+	}
+};
+
+double bench(unsigned workers, int roots, int width) {
+	// before the pool: the last leaf may still be inside set_value() when
+	// the wait returns, the pool's destructor joins it before f goes away
+	FanOut f{{(long)roots * width}, {}};
+	x::ThreadPool pool{workers};
+	auto start = std::chrono::steady_clock::now();
+	std::vector<x::ThreadPool::Closure> batch(roots, [&pool, &f, width] {
+		for (int i = 0; i < width; ++i) pool.post([&f] { f.leaf(); });
+	});
+	pool.post_batch(batch.begin(), batch.end());
+	f.done.get_future().wait();
+	auto end = std::chrono::steady_clock::now();
+	return (double)roots * width / std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+	test_deque();
+	test_pool();
+
+	unsigned max_workers = std::max(4u, std::thread::hardware_concurrency());
+	for (unsigned workers = 1; workers <= max_workers; workers *= 2) {
+		std::cout << workers << " workers: " << bench(workers, 1000, 1000) / 1e6 << " Mtasks/s" << std::endl;
+	}
+
+	std::cout << "ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace x {
+
+// Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli, "Correct and
+// Efficient Work-Stealing for Weak Memory Models", 2013).
+// The owner pushes and pops at the bottom, thieves steal from the top.
+// Memory only grows: the deque never shrinks, and every array it outgrew is
+// kept until the deque dies because a thief may still be reading it. Sizes
+// double, so the retired arrays add up to less than the current one.
+template <typename T> class WorkStealingDeque {
+	static_assert(std::is_trivially_copyable<T>::value, "deque holds plain values (e.g. pointers)");
+
+public:
+	explicit WorkStealingDeque(int64_t capacity = 256) : array_{new Array(capacity)} {
+		retired_.emplace_back(array_.load(std::memory_order_relaxed));
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	// owner only
+	void push(T x) {
+		int64_t b = bottom_.load(std::memory_order_relaxed);
+		int64_t t = top_.load(std::memory_order_acquire);
+		Array* a = array_.load(std::memory_order_relaxed);
+		if (b - t > a->capacity - 1) {
+			a = grow(a, b, t);
+		}
+		a->put(b, x);
+		bottom_.store(b + 1, std::memory_order_release);
+	}
+
+	// owner only
+	bool pop(T& x) {
+		int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+		Array* a = array_.load(std::memory_order_relaxed);
+		bottom_.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top_.load(std::memory_order_relaxed);
+		bool found = false;
+		if (t <= b) {
+			x = a->get(b);
+			found = true;
+			if (t == b) {
+				// last item, race the thieves for it
+				found = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				bottom_.store(b + 1, std::memory_order_relaxed);
+			}
+		} else {
+			bottom_.store(b + 1, std::memory_order_relaxed);
+		}
+		return found;
+	}
+
+	// any thread
+	bool steal(T& x) {
+		int64_t t = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom_.load(std::memory_order_acquire);
+		if (t < b) {
+			Array* a = array_.load(std::memory_order_acquire);
+			x = a->get(t);
+			return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+		return false;
+	}
+
+	bool empty() const noexcept {
+		int64_t b = bottom_.load(std::memory_order_relaxed);
+		int64_t t = top_.load(std::memory_order_relaxed);
+		return b <= t;
+	}
+
+private:
+	struct Array {
+		explicit Array(int64_t n) : capacity{n}, mask{n - 1}, items{new std::atomic<T>[n]} { }
+
+		T get(int64_t i) const noexcept { return items[i & mask].load(std::memory_order_relaxed); }
+
+		void put(int64_t i, T x) noexcept { items[i & mask].store(x, std::memory_order_relaxed); }
+
+		const int64_t capacity;
+		const int64_t mask;
+		std::unique_ptr<std::atomic<T>[]> items;
+	};
+
+	Array* grow(Array* a, int64_t b, int64_t t) {
+		Array* bigger = new Array(a->capacity * 2);
+		for (int64_t i = t; i < b; ++i) {
+			bigger->put(i, a->get(i));
+		}
+		retired_.emplace_back(bigger);
+		array_.store(bigger, std::memory_order_release);
+		return bigger;
+	}
+
+	alignas(64) std::atomic<int64_t> top_{0};
+	alignas(64) std::atomic<int64_t> bottom_{0};
+	alignas(64) std::atomic<Array*> array_;
+	std::vector<std::unique_ptr<Array>> retired_;
+};
+
+// Multi-worker executor: each worker owns a Chase-Lev deque, idle workers
+// steal from random victims and then park on a condition variable.
+// Tasks posted from a worker go to its own deque (LIFO, cache friendly),
+// tasks posted from other threads go to a shared injection queue.
+// Tasks still queued when the pool is destroyed are run before it returns.
+class ThreadPool {
+public:
+	typedef std::function<void()> Closure;
+
+	explicit ThreadPool(unsigned workers = std::thread::hardware_concurrency()) {
+		if (workers == 0) workers = 1;
+		for (unsigned i = 0; i < workers; ++i) {
+			workers_.emplace_back(new Worker);
+		}
+		for (unsigned i = 0; i < workers; ++i) {
+			workers_[i]->thread = std::thread(&ThreadPool::run, this, i);
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(park_mtx_);
+			stop_ = true;
+			++park_epoch_;
+		}
+		park_cv_.notify_all();
+		for (auto& w : workers_) {
+			w->thread.join();
+		}
+	}
+
+	size_t size() const noexcept { return workers_.size(); }
+
+	void post(Closure closure) {
+		enqueue(new Closure(std::move(closure)));
+		wake(1);
+	}
+
+	template <typename It> void post_batch(It first, It last) {
+		size_t n = 0;
+		if (current_pool_ == this) {
+			for (; first != last; ++first, ++n) {
+				workers_[current_worker_]->deque.push(new Closure(*first));
+			}
+		} else {
+			std::lock_guard<std::mutex> lock(inject_mtx_);
+			for (; first != last; ++first, ++n) {
+				inject_.push_back(new Closure(*first));
+			}
+			injected_.store(inject_.size(), std::memory_order_relaxed);
+		}
+		wake(n);
+	}
+
+	template <typename F> auto submit(F&& f) -> std::future<std::invoke_result_t<F>> {
+		using R = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+		std::future<R> result = task->get_future();
+		post([task] { (*task)(); });
+		return result;
+	}
+
+private:
+	struct Worker {
+		WorkStealingDeque<Closure*> deque;
+		std::thread thread;
+	};
+
+	void enqueue(Closure* task) {
+		if (current_pool_ == this) {
+			workers_[current_worker_]->deque.push(task);
+		} else {
+			std::lock_guard<std::mutex> lock(inject_mtx_);
+			inject_.push_back(task);
+			injected_.store(inject_.size(), std::memory_order_relaxed);
+		}
+	}
+
+	// pairs with the fence in park(): either the parking worker sees the new
+	// task when it looks again, or we see it parked and bump the epoch
+	void wake(size_t n) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (n == 0 || parked_.load(std::memory_order_relaxed) == 0) return;
+		{
+			std::lock_guard<std::mutex> lock(park_mtx_);
+			++park_epoch_;
+		}
+		if (n == 1) {
+			park_cv_.notify_one();
+		} else {
+			park_cv_.notify_all();
+		}
+	}
+
+	bool take_injected(Closure*& task) {
+		if (injected_.load(std::memory_order_relaxed) == 0) return false;
+		std::lock_guard<std::mutex> lock(inject_mtx_);
+		if (inject_.empty()) return false;
+		task = inject_.front();
+		inject_.pop_front();
+		injected_.store(inject_.size(), std::memory_order_relaxed);
+		return true;
+	}
+
+	bool find_task(unsigned self, uint32_t& rng, Closure*& task) {
+		if (workers_[self]->deque.pop(task)) return true;
+		if (take_injected(task)) return true;
+		const unsigned n = workers_.size();
+		for (unsigned attempt = 0; attempt < 2 * n; ++attempt) {
+			// xorshift32
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			unsigned victim = rng % n;
+			if (victim != self && workers_[victim]->deque.steal(task)) return true;
+		}
+		return false;
+	}
+
+	// returns false when the pool is stopping and there is no work left
+	bool park(unsigned self, uint32_t& rng, Closure*& task) {
+		uint64_t epoch;
+		{
+			std::lock_guard<std::mutex> lock(park_mtx_);
+			if (stop_) return false;
+			epoch = park_epoch_;
+		}
+		parked_.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (find_task(self, rng, task)) {
+			parked_.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		{
+			std::unique_lock<std::mutex> lock(park_mtx_);
+			park_cv_.wait(lock, [&] { return park_epoch_ != epoch; });
+		}
+		parked_.fetch_sub(1, std::memory_order_relaxed);
+		task = nullptr;
+		return true;
+	}
+
+	void run(unsigned self) {
+		current_pool_ = this;
+		current_worker_ = self;
+		uint32_t rng = 2463534242u + self * 7919u;
+		for (;;) {
+			Closure* task = nullptr;
+			if (!find_task(self, rng, task)) {
+				if (!park(self, rng, task)) {
+					// stopping: drain whatever is still visible
+					if (!find_task(self, rng, task)) break;
+				}
+				if (!task) continue;
+			}
+			(*task)();
+			delete task;
+		}
+		current_pool_ = nullptr;
+	}
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+
+	std::mutex inject_mtx_;
+	std::deque<Closure*> inject_;
+	std::atomic<size_t> injected_{0};
+
+	std::atomic<unsigned> parked_{0};
+	std::mutex park_mtx_;
+	std::condition_variable park_cv_;
+	uint64_t park_epoch_ = 0;
+	bool stop_ = false;
+
+	static inline thread_local ThreadPool* current_pool_ = nullptr;
+	static inline thread_local unsigned current_worker_ = 0;
+};
+
+} // namespace x
@@ -0,0 +1,86 @@
+// g++ -O2 -std=c++17 -Wall -Wextra unique_function.cpp
+
+#include "unique_function.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// count every heap allocation
+static size_t allocations = 0;
+
+void* operator new(size_t n) {
+	++allocations;
+	if (void* p = std::malloc(n)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct Counted {
+	static int alive;
+	Counted() { ++alive; }
+	Counted(const Counted&) { ++alive; }
+	Counted(Counted&&) noexcept { ++alive; }
+	~Counted() { --alive; }
+};
+
+int Counted::alive = 0;
+
+int main() {
+	using Task = x::unique_function<void(), 64>;
+
+	// small captures stay inline, moving them allocates nothing
+	std::vector<Task> slab(16);
+	int sum = 0;
+	size_t before = allocations;
+	for (int i = 0; i < 16; ++i) {
+		int a = i, b = 2 * i;
+		slab[i] = Task([&sum, a, b] { sum += a + b; });
+		assert(!slab[i].on_heap());
+	}
+	Task moved = std::move(slab[0]);
+	assert(!slab[0]);
+	moved();
+	for (int i = 1; i < 16; ++i) slab[i]();
+	assert(allocations == before);
+	assert(sum == 3 * (15 * 16 / 2));
+
+	// big captures spill
+	char big[100] = {'x'};
+	Task spill([big, &sum] { sum += big[0]; });
+	assert(spill.on_heap());
+	spill();
+	assert(allocations == before + 1);
+
+	// move-only captures, arguments and return values
+	x::unique_function<int(int), 32> add{[p = std::make_unique<int>(40)](int v) { return *p + v; }};
+	assert(add(2) == 42);
+	x::unique_function<std::string(std::string&&)> echo{[](std::string&& s) { return std::move(s); }};
+	assert(echo("hi") == "hi");
+
+	// callables are destroyed exactly once, inline or not
+	{
+		Task inline_task{[c = Counted{}] { (void)c; }};
+		Task heap_task{[c = Counted{}, big] { (void)c; (void)big; }};
+		Task t = std::move(inline_task);
+		t = std::move(heap_task);
+		assert(Counted::alive == 1);
+	}
+	assert(Counted::alive == 0);
+
+	Task empty;
+	try {
+		empty();
+		assert(false);
+	} catch (const std::bad_function_call&) {
+	}
+
+	std::cout << "ok" << std::endl;
+	return 0;
+}
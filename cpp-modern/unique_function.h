@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace x {
+
+template <typename Signature, size_t Capacity = 64> class unique_function;
+
+// move-only std::function replacement: callables up to Capacity bytes (and
+// nothrow movable) live inline, bigger ones spill to the heap (see on_heap())
+template <typename R, typename... Args, size_t Capacity>
+class unique_function<R(Args...), Capacity> {
+public:
+	unique_function() noexcept = default;
+
+	unique_function(std::nullptr_t) noexcept { }
+
+	template <typename F, typename D = std::decay_t<F>,
+	          typename = std::enable_if_t<!std::is_same<D, unique_function>::value &&
+	                                      std::is_invocable_r<R, D&, Args...>::value>>
+	unique_function(F&& f) {
+		if constexpr (fits<D>()) {
+			new (storage_) D(std::forward<F>(f));
+			vtable_ = &inline_vtable<D>;
+		} else {
+			*reinterpret_cast<D**>(storage_) = new D(std::forward<F>(f));
+			vtable_ = &heap_vtable<D>;
+		}
+	}
+
+	unique_function(unique_function&& other) noexcept : vtable_{other.vtable_} {
+		if (vtable_) {
+			vtable_->move(storage_, other.storage_);
+			other.vtable_ = nullptr;
+		}
+	}
+
+	unique_function& operator=(unique_function&& other) noexcept {
+		if (this != &other) {
+			reset();
+			if (other.vtable_) {
+				other.vtable_->move(storage_, other.storage_);
+				vtable_ = other.vtable_;
+				other.vtable_ = nullptr;
+			}
+		}
+		return *this;
+	}
+
+	unique_function(const unique_function&) = delete;
+
+	unique_function& operator=(const unique_function&) = delete;
+
+	~unique_function() { reset(); }
+
+	explicit operator bool() const noexcept { return vtable_ != nullptr; }
+
+	bool on_heap() const noexcept { return vtable_ && vtable_->heap; }
+
+	R operator()(Args... args) {
+		if (!vtable_) throw std::bad_function_call();
+		return vtable_->invoke(storage_, std::forward<Args>(args)...);
+	}
+
+	void reset() noexcept {
+		if (vtable_) {
+			vtable_->destroy(storage_);
+			vtable_ = nullptr;
+		}
+	}
+
+private:
+	struct VTable {
+		R (*invoke)(void*, Args&&...);
+		void (*move)(void* dst, void* src) noexcept;
+		void (*destroy)(void*) noexcept;
+		bool heap;
+	};
+
+	template <typename D> static constexpr bool fits() {
+		return sizeof(D) <= Capacity && alignof(D) <= alignof(std::max_align_t) &&
+		       std::is_nothrow_move_constructible<D>::value;
+	}
+
+	template <typename D> static constexpr VTable inline_vtable = {
+		[](void* p, Args&&... args) -> R {
+			return std::invoke(*static_cast<D*>(p), std::forward<Args>(args)...);
+		},
+		[](void* dst, void* src) noexcept {
+			new (dst) D(std::move(*static_cast<D*>(src)));
+			static_cast<D*>(src)->~D();
+		},
+		[](void* p) noexcept { static_cast<D*>(p)->~D(); },
+		false,
+	};
+
+	template <typename D> static constexpr VTable heap_vtable = {
+		[](void* p, Args&&... args) -> R {
+			return std::invoke(**static_cast<D**>(p), std::forward<Args>(args)...);
+		},
+		[](void* dst, void* src) noexcept { *static_cast<D**>(dst) = *static_cast<D**>(src); },
+		[](void* p) noexcept { delete *static_cast<D**>(p); },
+		true,
+	};
+
+	static_assert(Capacity >= sizeof(void*), "need room for the heap pointer");
+
+	alignas(std::max_align_t) unsigned char storage_[Capacity];
+	const VTable* vtable_ = nullptr;
+};
+
+} // namespace x
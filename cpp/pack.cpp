@@ -1,8 +1,315 @@
-#include <vector>
-#include <iostream>
-#include <cstdint>
+// Serializer for aggregate structs: the fields are found at compile time
+// (brace-init counting plus structured bindings), the wire layout is the
+// fields back to back, little-endian, no padding. Packing writes into a
+// caller's buffer, an arena or a returned std::array, never the heap; a
+// trivially copyable struct without padding is one memcpy. view<T> reads
+// fields straight from received bytes.
+// Fields: integers, floating point, enums, std::array and nested aggregates
+// (C arrays and base classes are not supported).
+// g++ -std=c++17 -O2 -Wall -Wextra pack.cpp
+
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <iostream>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace serial {
+
+constexpr bool host_little_endian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+namespace detail {
+
+template <typename T>
+struct is_std_array : std::false_type {};
+
+template <typename E, size_t N>
+struct is_std_array<std::array<E, N>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_scalar_field = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+template <typename T>
+constexpr bool is_record = std::is_aggregate_v<T> && std::is_class_v<T> && !is_std_array<T>::value;
+
+// converts to any field type, T{any, any, ...} tells how many fields T has
+template <size_t>
+struct any {
+	template <typename T>
+	constexpr operator T() const;
+};
+
+template <typename T, size_t... I>
+constexpr auto initializable(std::index_sequence<I...>) -> decltype(T{any<I>{}...}, true) {
+	return true;
+}
+
+template <typename T>
+constexpr bool initializable(...) {
+	return false;
+}
+
+constexpr size_t max_fields = 8;
+
+template <typename T, size_t N = max_fields>
+constexpr size_t field_count() {
+	if constexpr (N == 0) {
+		return 0;
+	} else if constexpr (initializable<T>(std::make_index_sequence<N>{})) {
+		return N;
+	} else {
+		return field_count<T, N - 1>();
+	}
+}
+
+// a tuple of references to the fields of x
+template <typename T>
+constexpr auto fields(T& x) {
+	constexpr size_t n = field_count<std::remove_const_t<T>>();
+	static_assert(n > 0 && n <= max_fields, "1 to 8 fields supported");
+	if constexpr (n == 1) {
+		auto& [a] = x;
+		return std::tie(a);
+	} else if constexpr (n == 2) {
+		auto& [a, b] = x;
+		return std::tie(a, b);
+	} else if constexpr (n == 3) {
+		auto& [a, b, c] = x;
+		return std::tie(a, b, c);
+	} else if constexpr (n == 4) {
+		auto& [a, b, c, d] = x;
+		return std::tie(a, b, c, d);
+	} else if constexpr (n == 5) {
+		auto& [a, b, c, d, e] = x;
+		return std::tie(a, b, c, d, e);
+	} else if constexpr (n == 6) {
+		auto& [a, b, c, d, e, f] = x;
+		return std::tie(a, b, c, d, e, f);
+	} else if constexpr (n == 7) {
+		auto& [a, b, c, d, e, f, g] = x;
+		return std::tie(a, b, c, d, e, f, g);
+	} else {
+		auto& [a, b, c, d, e, f, g, h] = x;
+		return std::tie(a, b, c, d, e, f, g, h);
+	}
+}
+
+template <typename T, size_t I>
+using field_type = std::remove_reference_t<std::tuple_element_t<I, decltype(fields(std::declval<T&>()))>>;
+
+template <typename T>
+constexpr size_t wire_size();
+
+template <typename T, size_t... I>
+constexpr size_t record_size(std::index_sequence<I...>) {
+	return (wire_size<field_type<T, I>>() + ... + 0);
+}
+
+template <typename T>
+constexpr size_t wire_size() {
+	if constexpr (is_scalar_field<T>) {
+		return sizeof(T);
+	} else if constexpr (is_std_array<T>::value) {
+		return std::tuple_size<T>::value * wire_size<typename T::value_type>();
+	} else {
+		static_assert(is_record<T>, "fields must be arithmetic, enum, std::array or aggregate");
+		return record_size<T>(std::make_index_sequence<field_count<T>()>{});
+	}
+}
+
+template <typename T, size_t I>
+constexpr size_t offset() {
+	if constexpr (I == 0) {
+		return 0;
+	} else {
+		return offset<T, I - 1>() + wire_size<field_type<T, I - 1>>();
+	}
+}
+
+// the bytes of T are its wire format: no padding anywhere, host order
+template <typename T>
+constexpr bool memcpy_layout() {
+	return host_little_endian && std::is_trivially_copyable_v<T> && wire_size<T>() == sizeof(T);
+}
+
+template <typename T>
+T byteswap(T v) {
+	if constexpr (sizeof(T) == 1 || host_little_endian) {
+		return v;
+	} else {
+		uint8_t b[sizeof(T)];
+		std::memcpy(b, &v, sizeof(T));
+		for (size_t i = 0; i < sizeof(T) / 2; ++i) std::swap(b[i], b[sizeof(T) - 1 - i]);
+		std::memcpy(&v, b, sizeof(T));
+		return v;
+	}
+}
+
+template <typename T>
+void write(const T& x, uint8_t* out);
+
+template <typename T>
+void read(const uint8_t* in, T& x);
+
+// offsets are compile time constants, so each field is a fixed size store
+template <typename T, typename... F, size_t... I>
+void write_fields(const std::tuple<const F&...>& f, uint8_t* out, std::index_sequence<I...>) {
+	(write(std::get<I>(f), out + offset<T, I>()), ...);
+}
+
+template <typename T, typename... F, size_t... I>
+void read_fields(const uint8_t* in, const std::tuple<F&...>& f, std::index_sequence<I...>) {
+	(read(in + offset<T, I>(), std::get<I>(f)), ...);
+}
+
+template <typename T>
+void write(const T& x, uint8_t* out) {
+	if constexpr (memcpy_layout<T>()) {
+		std::memcpy(out, &x, sizeof(T));
+	} else if constexpr (is_scalar_field<T>) {
+		const T v = byteswap(x);
+		std::memcpy(out, &v, sizeof(T));
+	} else if constexpr (is_std_array<T>::value) {
+		constexpr size_t step = wire_size<typename T::value_type>();
+		for (size_t i = 0; i < x.size(); ++i) write(x[i], out + i * step);
+	} else {
+		write_fields<T>(fields(x), out, std::make_index_sequence<field_count<T>()>{});
+	}
+}
+
+template <typename T>
+void read(const uint8_t* in, T& x) {
+	if constexpr (memcpy_layout<T>()) {
+		std::memcpy(&x, in, sizeof(T));
+	} else if constexpr (is_scalar_field<T>) {
+		std::memcpy(&x, in, sizeof(T));
+		x = byteswap(x);
+	} else if constexpr (is_std_array<T>::value) {
+		constexpr size_t step = wire_size<typename T::value_type>();
+		for (size_t i = 0; i < x.size(); ++i) read(in + i * step, x[i]);
+	} else {
+		read_fields<T>(in, fields(x), std::make_index_sequence<field_count<T>()>{});
+	}
+}
+
+}  // namespace detail
+
+template <typename T>
+constexpr size_t wire_size = detail::wire_size<T>();
+
+template <typename T>
+class view;
+
+namespace detail {
+
+// a scalar by value, anything else as a view of its bytes
+template <typename F>
+auto get(const uint8_t* p) {
+	if constexpr (is_scalar_field<F>) {
+		F v;
+		read(p, v);
+		return v;
+	} else {
+		return view<F>{p};
+	}
+}
+
+}  // namespace detail
+
+// Read-only window on the wire bytes of a T. Nothing is copied until a
+// field is asked for; the bytes must outlive the view.
+template <typename T>
+class view {
+ public:
+	static constexpr size_t size = wire_size<T>;
+
+	explicit view(const uint8_t* data) : data_{data} {}
+
+	// field I: scalars by value, records and arrays as views
+	template <size_t I>
+	auto get() const {
+		static_assert(detail::is_record<T>, "get<I>() is for structs, use [] on arrays");
+		return detail::get<detail::field_type<T, I>>(data_ + detail::offset<T, I>());
+	}
+
+	auto operator[](size_t i) const {
+		static_assert(detail::is_std_array<T>::value, "[] is for std::array fields");
+		using E = typename T::value_type;
+		assert(i < std::tuple_size<T>::value);
+		return detail::get<E>(data_ + i * wire_size<E>);
+	}
+
+	T load() const {
+		T x{};
+		detail::read(data_, x);
+		return x;
+	}
+
+	const uint8_t* data() const { return data_; }
+
+ private:
+	const uint8_t* data_;
+};
+
+// a view of the first wire_size<T> bytes, none when there are fewer
+template <typename T>
+std::optional<view<T>> view_of(const uint8_t* data, size_t size) {
+	if (size < wire_size<T>) return std::nullopt;
+	return view<T>{data};
+}
+
+// writes x to out, returns the bytes written or 0 when size is too small
+template <typename T>
+size_t pack(const T& x, uint8_t* out, size_t size) {
+	if (size < wire_size<T>) return 0;
+	detail::write(x, out);
+	return wire_size<T>;
+}
+
+template <typename T>
+std::array<uint8_t, wire_size<T>> pack(const T& x) {
+	std::array<uint8_t, wire_size<T>> out;
+	detail::write(x, out.data());
+	return out;
+}
+
+// bump allocator over a caller's buffer, reset() reuses it from the start
+class arena {
+ public:
+	arena(uint8_t* buffer, size_t size) : begin_{buffer}, next_{buffer}, end_{buffer + size} {}
+
+	uint8_t* allocate(size_t n) {
+		if (static_cast<size_t>(end_ - next_) < n) return nullptr;
+		uint8_t* p = next_;
+		next_ += n;
+		return p;
+	}
+
+	void reset() { next_ = begin_; }
+
+	size_t used() const { return static_cast<size_t>(next_ - begin_); }
+
+ private:
+	uint8_t* const begin_;
+	uint8_t* next_;
+	uint8_t* const end_;
+};
+
+// packs x into the arena and returns a view of it, none when it is full
+template <typename T>
+std::optional<view<T>> pack(const T& x, arena& a) {
+	uint8_t* p = a.allocate(wire_size<T>);
+	if (!p) return std::nullopt;
+	detail::write(x, p);
+	return view<T>{p};
+}
+
+}  // namespace serial
 
 struct X {
 	int a;
@@ -10,24 +317,84 @@ struct X {
 	int c;
 };
 
-std::vector<uint8_t> pack(const X& x) {
-	std::vector<uint8_t> v;
-	v.resize(3 * sizeof(int));
-	std::memcpy(&v[0], &x.a, sizeof(int));
-	std::memcpy(&v[4], &x.b, sizeof(int));
-	std::memcpy(&v[8], &x.c, sizeof(int));
-	return v;
+enum class kind : uint8_t { sample = 1, event = 2 };
+
+struct Y {
+	kind k;
+	uint32_t id;
+	double time;
+	std::array<int16_t, 3> axes;
+	X x;
+};
+
+struct Z {
+	Y y;
+	float gain;
+};
+
+bool operator==(const X& l, const X& r) { return l.a == r.a && l.b == r.b && l.c == r.c; }
+
+bool operator==(const Y& l, const Y& r) {
+	return l.k == r.k && l.id == r.id && l.time == r.time && l.axes == r.axes && l.x == r.x;
 }
 
 int main() {
+	static_assert(serial::detail::field_count<X>() == 3);
+	static_assert(serial::detail::field_count<Y>() == 5);
+	static_assert(serial::wire_size<X> == 12);
+	static_assert(serial::wire_size<Y> == 1 + 4 + 8 + 6 + 12);
+	static_assert(serial::wire_size<Z> == serial::wire_size<Y> + 4);
+	static_assert(serial::detail::offset<Y, 4>() == 19);
+	static_assert(!serial::host_little_endian || serial::detail::memcpy_layout<X>());
+	static_assert(!serial::detail::memcpy_layout<Y>());  // padded
+
 	X x = { 1, 2, 3 };
-	std::vector<uint8_t> data = pack(x);
+	auto data = serial::pack(x);
 
-	std::vector<uint8_t> expected = { 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0 };
+	std::array<uint8_t, 12> expected = { 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0 };
 
 	assert(data.size() == expected.size());
 	assert(data == expected);
 
+	// padded struct: fields back to back, little-endian
+	Y y = { kind::event, 0x01020304, 0.5, { -1, 2, -3 }, { 4, 5, 6 } };
+	uint8_t buffer[64];
+	assert(serial::pack(y, buffer, sizeof(buffer)) == serial::wire_size<Y>);
+	assert(buffer[0] == 2);
+	assert(buffer[1] == 4 && buffer[2] == 3 && buffer[3] == 2 && buffer[4] == 1);
+	assert(buffer[13] == 0xff && buffer[14] == 0xff);
+	assert(buffer[19] == 4 && buffer[23] == 5 && buffer[27] == 6);
+	assert(serial::pack(y, buffer, serial::wire_size<Y> - 1) == 0);
+
+	// zero-copy reader
+	auto v = serial::view_of<Y>(buffer, serial::wire_size<Y>);
+	assert(v);
+	assert(v->get<0>() == kind::event);
+	assert(v->get<1>() == 0x01020304u);
+	assert(v->get<2>() == 0.5);
+	assert(v->get<3>()[2] == -3);
+	assert(v->get<4>().get<1>() == 5);
+	assert(v->get<4>().data() == buffer + 19);
+	assert(v->load() == y);
+	assert(v->get<4>().load() == (X{4, 5, 6}));
+	assert(!serial::view_of<Y>(buffer, serial::wire_size<Y> - 1));
+
+	// nested record, arena backed
+	uint8_t storage[3 * serial::wire_size<Z>];
+	serial::arena a{storage, sizeof(storage)};
+	for (int i = 0; i < 3; ++i) {
+		Z z = { y, 0.25f * i };
+		z.y.id = i;
+		auto packed = serial::pack(z, a);
+		assert(packed);
+		assert(packed->get<0>().get<1>() == static_cast<uint32_t>(i));
+		assert(packed->get<1>() == 0.25f * i);
+	}
+	assert(a.used() == sizeof(storage));
+	assert(!serial::pack(Z{}, a));
+	a.reset();
+	assert(serial::pack(Z{}, a));
+
 	std::cout << "OK" << std::endl;
 
 	return 0;